@@ -0,0 +1,66 @@
+#ifndef ADDRESS_LOWERING_H_
+#define ADDRESS_LOWERING_H_
+
+#include "koopa.h"
+#include "machine_ir.h"
+
+#include <utility>
+#include <vector>
+
+/*
+ * address arithmetic of `getelemptr` and `getptr`
+ *
+ * a chain of them, one per dimension, is folded into the load or store at
+ * its end as `root + index * stride + ... + offset`. The constant indexes
+ * sum up into the displacement of the `lw` or `sw`, power-of-2 strides are
+ * scaled by `slli`, and the memory of an `alloc` is addressed from `sp`
+ * directly instead of through the pointer to it.
+ */
+namespace riscv_trans {
+
+    struct Address {
+        /* pseudo id of an `alloc` if `is_stack`, otherwise a pointer */
+        koopa::Id* root;
+        bool is_stack;
+        std::vector<std::pair<koopa::Id*, int>> scaled_indexes;
+        int offset;
+    };
+
+    /*
+     * sink every `getelemptr` and `getptr` of `func_def` used only as the
+     * address of a statement later in its block right before that statement,
+     * and collect into `current_folded_ids` those and the `alloc`s only
+     * used as addresses, which their users compute for themselves.
+     *
+     * Nothing is defined between a folded value and its user after sinking,
+     * so the identifiers it reads still hold when its user reads them instead.
+     */
+    void lower_addresses(const koopa::FuncDef* func_def);
+
+    /**
+     * @return  address held by `ptr`, in terms of values that are not folded
+     */
+    Address get_address(koopa::Id* ptr);
+
+    /**
+     * @return  address of `base + index * stride`
+     */
+    Address get_address(koopa::Id* base, koopa::Value* index, int stride);
+
+    /**
+     * compute `address` but its constant offset
+     *
+     * @return  register holding the address minus `offset`, a scratch
+     *          register unless it is read in place
+     */
+    Register address_to_riscv(MachineBasicBlock& mbb, const Address& address, int& offset);
+
+    /**
+     * @return  offsets from `sp` of the accesses of `func_def` to the memory
+     *          declared by `alloc`, once the stack frame is laid out
+     */
+    std::vector<int> get_stack_access_offsets(const koopa::FuncDef* func_def);
+
+}
+
+#endif
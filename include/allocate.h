@@ -0,0 +1,78 @@
+#ifndef ALLOCATE_H_
+#define ALLOCATE_H_
+
+#include "koopa.h"
+#include "liveness.h"
+
+#include <utility>
+#include <vector>
+
+namespace riscv_trans {
+
+    /*
+     * live interval of an identifier over the statements of a function,
+     * numbered in block order. statement `i` reads its operands at `2i` and
+     * writes its result at `2i + 1`, so an interval ending at a use may share
+     * a register with one starting at the same statement.
+     */
+    struct LiveInterval {
+        koopa::Id* id;
+        int start;
+        int end;
+        /* live across a call, which clobbers all caller-saved registers */
+        bool crosses_call;
+        /* live while the arguments of a call are moved into a0-a7 */
+        bool covers_call;
+        /* number of calls it is live across */
+        int crossed_call_n;
+        /* number of statements using or defining the identifier */
+        int ref_n;
+    };
+
+    /**
+     * @return  live intervals of `ids` in `func_def`, sorted by start.
+     *          identifiers never referred to get no interval
+     */
+    std::vector<LiveInterval> build_live_intervals(
+        const koopa::FuncDef* func_def,
+        const std::vector<koopa::Id*>& ids
+    );
+
+    /**
+     * @return  call made by `stmt`, a `FuncCall` or a `SymbolDef` of one,
+     *          nullptr if there is none
+     */
+    koopa::FuncCall* get_func_call(koopa::Stmt* stmt);
+
+    /**
+     * @return  calls of `func_def` with the index of their statement, in the
+     *          numbering of `build_live_intervals`
+     */
+    std::vector<std::pair<int, koopa::FuncCall*>> get_indexed_calls(const koopa::FuncDef* func_def);
+
+    /**
+     * @return  identifiers declared by `alloc`, which are memory themselves
+     *          and always live on the stack frame
+     */
+    std::vector<koopa::Id*> get_pseudo_ids(const koopa::FuncDef* func_def);
+
+    /**
+     * @return  identifiers defined in `func_def`, the results of its
+     *          statements and the parameters of its blocks, in program
+     *          order. Formal parameters are not included, nor identifiers
+     *          whose definition an optimization has removed
+     */
+    std::vector<koopa::Id*> get_value_ids(const koopa::FuncDef* func_def);
+
+    /**
+     * register identifiers of `func_def` that obtain a register into
+     * `id_storage_map`
+     *
+     * @return  identifiers left for the stack frame, pseudo ids and spills
+     */
+    std::vector<koopa::Id*> linear_scan_allocate(const koopa::FuncDef* func_def);
+    std::vector<koopa::Id*> graph_coloring_allocate(const koopa::FuncDef* func_def);
+
+}
+
+#endif
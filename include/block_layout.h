@@ -0,0 +1,23 @@
+#ifndef BLOCK_LAYOUT_H_
+#define BLOCK_LAYOUT_H_
+
+#include "machine_ir.h"
+
+namespace riscv_trans {
+
+    /*
+     * whether `layout_blocks` is applied before printing, cleared by
+     * `-no-block-layout`
+     */
+    extern bool enable_block_layout;
+
+    /*
+     * reorder the blocks of `func` so that the likely successor of each block
+     * follows it, keeping the blocks of a loop together and moving its exits
+     * out, then invert the branches and drop the jumps made redundant
+     */
+    void layout_blocks(MachineFunction& func);
+
+}
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef CFG_H_
+#define CFG_H_
+
+#include "dataflow.h"
+#include "koopa.h"
+
+#include <unordered_map>
+#include <vector>
+
+/*
+ * control flow graph of a koopa function with its dominator tree and loops
+ *
+ * the labels jumped to are resolved to block indexes once, when the graph is
+ * built, and everything after goes by index. The dominator tree comes from
+ * the iteration of Cooper, Harvey and Kennedy over the reverse postorder,
+ * which converges in a couple of passes on the graphs the front end builds;
+ * numbering the tree in preorder and postorder answers whether a block
+ * dominates another in constant time. A loop is natural, made of the blocks
+ * reaching a back edge, one whose target dominates its source, without
+ * passing through that target, its header. Back edges to the same header
+ * make up a single loop.
+ *
+ * `get_cfg` keeps the graph of each function until `invalidate_cfg`, which
+ * whatever adds, removes or redirects an edge or a block must call. A graph
+ * of something else, as the machine blocks `layout_blocks` reorders, is given
+ * its edges alone, with no koopa blocks.
+ */
+namespace dataflow {
+
+    struct Loop {
+        int header;
+        /* index into `Cfg::get_loops` of the innermost enclosing loop, -1 if none */
+        int parent;
+        /* 1 for an outermost loop */
+        int depth;
+        /* header first, then the others in increasing order */
+        std::vector<int> blocks;
+    };
+
+    class Cfg {
+    public:
+        Cfg(const koopa::FuncDef* func_def);
+        /*
+         * `flow_graph.blocks` may be null, a block being known by its index
+         * only
+         */
+        Cfg(FlowGraph flow_graph);
+
+        const FlowGraph& get_graph() const;
+        int get_block_n() const;
+        koopa::Block* get_block(int block) const;
+        /**
+         * @return  index of `block`, -1 if it is not one of the function
+         */
+        int get_index(const koopa::Block* block) const;
+
+        const std::vector<int>& get_succs(int block) const;
+        const std::vector<int>& get_preds(int block) const;
+
+        /**
+         * @return  reachable blocks in reverse postorder from the entry
+         */
+        const std::vector<int>& get_reverse_postorder() const;
+        bool is_reachable(int block) const;
+
+        /**
+         * @return  immediate dominator of `block`, -1 for the entry and the
+         *          unreachable blocks
+         */
+        int get_idom(int block) const;
+        const std::vector<int>& get_dom_children(int block) const;
+        /**
+         * @return  whether every path from the entry to `b` passes through
+         *          `a`, so also if they are the same. false if either is
+         *          unreachable
+         */
+        bool dominates(int a, int b) const;
+
+        /**
+         * @return  loops, each after the ones enclosing it
+         */
+        const std::vector<Loop>& get_loops() const;
+        /**
+         * @return  index into `get_loops` of the innermost loop `block` is
+         *          in, -1 if none
+         */
+        int get_loop(int block) const;
+        int get_loop_depth(int block) const;
+
+    private:
+        FlowGraph graph;
+        std::unordered_map<const koopa::Block*, int> indexes;
+
+        std::vector<int> order;
+        std::vector<int> idoms;
+        std::vector<std::vector<int>> dom_children;
+        std::vector<int> dom_preorders;
+        std::vector<int> dom_postorders;
+
+        std::vector<Loop> loops;
+        std::vector<int> block_loops;
+
+        void build_dom_tree();
+        void build_loops();
+    };
+
+    /**
+     * @return  for each block, the blocks in its dominance frontier: those it
+     *          does not strictly dominate but a predecessor of which it does
+     */
+    std::vector<std::vector<int>> get_dominance_frontiers(const Cfg& cfg);
+
+    /**
+     * @return  graph of `func_def`, built on the first request since the last
+     *          `invalidate_cfg` of it
+     */
+    const Cfg& get_cfg(const koopa::FuncDef* func_def);
+    void invalidate_cfg(const koopa::FuncDef* func_def);
+
+    /*
+     * remove the blocks of `func_def` the entry does not reach, invalidating
+     * its graph
+     *
+     * @return  whether any block was removed
+     */
+    bool remove_unreachable_blocks(koopa::FuncDef* func_def);
+
+}
+
+#endif
@@ -8,7 +8,7 @@
 class compiler_exception: public std::exception {
 public:
     compiler_exception(std::string message) {
-        this->message = new char[head_string_length + message.length()];
+        this->message = new char[head_string_length + message.length() + 1];
         strcpy(this->message, (head_string + message).c_str());
     }
 
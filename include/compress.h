@@ -0,0 +1,34 @@
+#ifndef COMPRESS_H_
+#define COMPRESS_H_
+
+#include "machine_ir.h"
+
+/*
+ * RVC, the 16-bit forms of the most common instructions
+ *
+ * once the function is laid out and cleaned up, every instruction meeting
+ * the register and immediate constraints of its compressed form is marked
+ * to be printed as such. `c.j`, `c.beqz` and `c.bnez` reach much less far
+ * than their full forms, so they are only taken when the target lies within
+ * reach, found by laying the function out again until nothing changes, which
+ * ends since instructions only get shorter.
+ */
+namespace riscv_trans {
+
+    /**
+     * @return   bytes `instr` assembles to, 8 for the pseudo instructions
+     *           expanding to two
+     * @example  get_byte_size(`li t0, 4096`) => 4 (a single `lui`)
+     */
+    int get_byte_size(const MachineInstr& instr);
+
+    /*
+     * mark the instructions of `func` to be printed compressed, reporting
+     * the bytes saved to stderr if `debug_mode_rvc`
+     * @example  `main: 212 -> 148 bytes (-30.2%)`
+     */
+    void compress_function(MachineFunction& func);
+
+}
+
+#endif
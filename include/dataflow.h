@@ -0,0 +1,129 @@
+#ifndef DATAFLOW_H_
+#define DATAFLOW_H_
+
+#include "koopa.h"
+
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+
+/*
+ * iterative bit-vector dataflow analyses over the blocks of a koopa function
+ *
+ * a client numbers the values it tracks densely with `ValueNumbering`, fills
+ * in the `gen` and `kill` sets of each block of a `Problem`, and `solve` runs
+ * a worklist until the sets at the block boundaries reach their fixed point.
+ */
+namespace dataflow {
+
+    /*
+     * fixed size set of small integers, one bit each
+     */
+    class BitSet {
+    public:
+        BitSet(int bit_n = 0);
+
+        int size() const;
+
+        void set(int i);
+        void reset(int i);
+        bool test(int i) const;
+        void set_all();
+
+        /**
+         * @return  whether the set changed
+         */
+        bool union_with(const BitSet& other);
+        bool intersect_with(const BitSet& other);
+        void subtract(const BitSet& other);
+
+        bool operator==(const BitSet& other) const;
+        bool operator!=(const BitSet& other) const;
+
+        /*
+         * call `f(i)` for every `i` in the set, in increasing order
+         */
+        template<typename F>
+        void for_each(F f) const {
+            for (int w { 0 }; w < words.size(); w++) {
+                auto word { words[w] };
+                while (word != 0) {
+                    f(w * 64 + __builtin_ctzll(word));
+                    word &= word - 1;
+                }
+            }
+        }
+
+    private:
+        int bit_n;
+        std::vector<uint64_t> words;
+    };
+
+    /*
+     * numbers the identifiers tracked by an analysis from 0
+     */
+    class ValueNumbering {
+    public:
+        ValueNumbering() = default;
+        ValueNumbering(const std::vector<koopa::Id*>& ids);
+
+        int size() const;
+
+        /**
+         * @return  number of `id`, -1 if it is not tracked
+         */
+        int get_number(const koopa::Id* id) const;
+        koopa::Id* get_id(int number) const;
+
+    private:
+        std::vector<koopa::Id*> ids;
+        std::unordered_map<const koopa::Id*, int> numbers;
+    };
+
+    /*
+     * blocks of a function in the order of `FuncDef::get_blocks`, the first
+     * one being the entry, with edges resolved from the labels jumped to
+     */
+    struct FlowGraph {
+        std::vector<koopa::Block*> blocks;
+        std::vector<std::vector<int>> succs;
+        std::vector<std::vector<int>> preds;
+    };
+
+    FlowGraph build_flow_graph(const koopa::FuncDef* func_def);
+
+    /**
+     * @return  blocks in reverse postorder from the entry, followed by the
+     *          unreachable ones
+     */
+    std::vector<int> get_reverse_postorder(const FlowGraph& graph);
+
+    enum class Direction { Forward, Backward };
+    enum class Meet { Union, Intersection };
+
+    /*
+     * `out = gen + (in - kill)` for a forward problem, `in = gen + (out - kill)`
+     * for a backward one. `boundary` is the value flowing into the entry block
+     * of a forward problem, or out of the exit blocks of a backward one.
+     */
+    struct Problem {
+        Direction direction;
+        Meet meet;
+        std::vector<BitSet> gens;
+        std::vector<BitSet> kills;
+        BitSet boundary;
+    };
+
+    /*
+     * sets at the beginning and the end of each block, whatever the direction
+     */
+    struct Solution {
+        std::vector<BitSet> in;
+        std::vector<BitSet> out;
+    };
+
+    Solution solve(const FlowGraph& graph, const Problem& problem);
+
+}
+
+#endif
@@ -10,5 +10,25 @@ extern int tmp_var_count;
  */
 extern bool debug_mode_koopa_type;
 extern bool debug_mode_riscv;
+/*
+ * if debug_mode_regalloc == true, the number of values spilled to the
+ * stack frame is reported for each function
+ */
+extern bool debug_mode_regalloc;
+/*
+ * if debug_mode_peephole == true, how many times each peephole rule fired
+ * is reported
+ */
+extern bool debug_mode_peephole;
+/*
+ * if debug_mode_rvc == true, the bytes each function takes before and after
+ * compression are reported
+ */
+extern bool debug_mode_rvc;
+/*
+ * if debug_mode_time_passes == true, the wall time each koopa pass takes and
+ * the size of the program before and after it are reported
+ */
+extern bool debug_mode_time_passes;
 
 #endif
\ No newline at end of file
@@ -124,7 +124,7 @@ public:
 
 class Value: public Base {
 public:
-    virtual riscv_trans::Register value_to_riscv(std::string& str) const = 0;
+    virtual riscv_trans::Register value_to_riscv(riscv_trans::MachineBasicBlock& mbb) const = 0;
 
     virtual bool is_const() = 0;
     virtual int get_val() = 0;
@@ -135,7 +135,7 @@ public:
     public:
         std::string to_string() const override;
 
-        riscv_trans::Register value_to_riscv(std::string& str) const override;
+        riscv_trans::Register value_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
 
         bool is_const() override;
         int get_val() override;
@@ -157,7 +157,7 @@ public:
     public:
         std::string to_string() const override;
 
-        riscv_trans::Register value_to_riscv(std::string& str) const override;
+        riscv_trans::Register value_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
 
         bool is_const() override;
         int get_val() override;
@@ -230,7 +230,7 @@ private:
 class Stmt: public Base {
 public:
     virtual void stmt_to_riscv(
-        std::string& str, 
+        riscv_trans::MachineModule& module, 
         riscv_trans::TransMode trans_mode
     ) const = 0;
 
@@ -239,6 +239,26 @@ public:
     virtual bool is_func_call() const;
     /* crash if is not a function calling */
     virtual unsigned get_func_call_param_n() const;
+
+    /**
+     * @return  identifiers read by the statement, global ones included
+     * @example  `store %1, @x` => { %1, @x }
+     */
+    virtual std::vector<Id*> get_used_ids() const;
+    /**
+     * @return  identifier defined by the statement, nullptr if there is none
+     */
+    virtual Id* get_def_id() const;
+    /**
+     * @return  labels of the blocks the statement may jump to
+     */
+    virtual std::vector<Label> get_target_labels() const;
+
+    /*
+     * replace the values read by the statement that are keys of `values`
+     * with what they map to
+     */
+    virtual void replace_uses(const std::unordered_map<Id*, Value*>& values);
 };
     class NotEndStmt: public Stmt {
         bool is_end_stmt() override;
@@ -250,12 +270,29 @@ public:
         class Rvalue: public Base {
         public:
             virtual riscv_trans::Register rvalue_to_riscv(
-                std::string& str
+                riscv_trans::MachineBasicBlock& mbb
             ) const = 0;
 
             virtual bool is_func_call() const;
             /* crash if is not a function calling */
             virtual unsigned get_func_call_param_n() const;
+
+            /*
+             * whether the rvalue is a comparison, which a branch on it may
+             * be fused with
+             */
+            virtual bool is_cmp() const;
+            /*
+             * jump to `target` if the comparison holds, without materializing
+             * its result. crash if is not a comparison
+             */
+            virtual void cmp_branch_to_riscv(
+                riscv_trans::MachineBasicBlock& mbb, std::string target
+            ) const;
+
+            virtual std::vector<Id*> get_used_ids() const;
+
+            virtual void replace_uses(const std::unordered_map<Id*, Value*>& values);
         };
 
             /**
@@ -282,9 +319,11 @@ public:
                 std::string to_string() const override;
 
                 riscv_trans::Register rvalue_to_riscv(
-                    std::string& str
+                    riscv_trans::MachineBasicBlock& mbb
                 ) const override;
 
+                Id* get_pseudo_id() const;
+
             private:
                 Id* pseudo_id;
                 Type* type;
@@ -297,9 +336,14 @@ public:
                 std::string to_string() const override;
 
                 riscv_trans::Register rvalue_to_riscv(
-                    std::string& str
+                    riscv_trans::MachineBasicBlock& mbb
                 ) const override;
 
+                std::vector<Id*> get_used_ids() const override;
+                void replace_uses(const std::unordered_map<Id*, Value*>& values) override;
+
+                Id* get_addr() const;
+
             private:
                 Id* addr;
             };
@@ -311,9 +355,17 @@ public:
                 GetPtr(Id* base, Value* offset);
 
                 riscv_trans::Register rvalue_to_riscv(
-                    std::string& str
+                    riscv_trans::MachineBasicBlock& mbb
                 ) const override;
 
+                std::vector<Id*> get_used_ids() const override;
+                void replace_uses(const std::unordered_map<Id*, Value*>& values) override;
+
+                Id* get_base() const;
+                Value* get_offset() const;
+                /* byte size of what `base` points to */
+                unsigned get_stride() const;
+
             private:
                 Id* base;
                 Value* offset;
@@ -326,8 +378,16 @@ public:
                 std::string to_string() const override;
 
                 riscv_trans::Register rvalue_to_riscv(
-                    std::string& str
+                    riscv_trans::MachineBasicBlock& mbb
                 ) const override;
+
+                std::vector<Id*> get_used_ids() const override;
+                void replace_uses(const std::unordered_map<Id*, Value*>& values) override;
+
+                Id* get_base() const;
+                Value* get_offset() const;
+                /* byte size of an element of the array `base` points to */
+                unsigned get_stride() const;
             
             private:
                 Id* base;
@@ -335,6 +395,13 @@ public:
             };
 
             class Expr: public Rvalue {
+            public:
+                std::vector<Id*> get_used_ids() const override;
+                void replace_uses(const std::unordered_map<Id*, Value*>& values) override;
+
+                Value* get_lv() const;
+                Value* get_rv() const;
+
             protected:
                 Value* lv;
                 Value* rv;
@@ -348,7 +415,10 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
+
+                    bool is_cmp() const override;
+                    void cmp_branch_to_riscv(riscv_trans::MachineBasicBlock& mbb, std::string target) const override;
                 };
                 
                 class Ne: public Expr {
@@ -357,7 +427,10 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
+
+                    bool is_cmp() const override;
+                    void cmp_branch_to_riscv(riscv_trans::MachineBasicBlock& mbb, std::string target) const override;
                 };
 
                 class Gt: public Expr {
@@ -366,7 +439,10 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
+
+                    bool is_cmp() const override;
+                    void cmp_branch_to_riscv(riscv_trans::MachineBasicBlock& mbb, std::string target) const override;
                 };
 
                 class Lt: public Expr {
@@ -375,7 +451,10 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
+
+                    bool is_cmp() const override;
+                    void cmp_branch_to_riscv(riscv_trans::MachineBasicBlock& mbb, std::string target) const override;
                 };
 
                 class Ge: public Expr {
@@ -384,7 +463,10 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
+
+                    bool is_cmp() const override;
+                    void cmp_branch_to_riscv(riscv_trans::MachineBasicBlock& mbb, std::string target) const override;
                 };
 
                 class Le: public Expr {
@@ -393,7 +475,10 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
+
+                    bool is_cmp() const override;
+                    void cmp_branch_to_riscv(riscv_trans::MachineBasicBlock& mbb, std::string target) const override;
                 };
 
                 class Add: public Expr {
@@ -402,7 +487,7 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
                 };
 
                 class Sub: public Expr {
@@ -411,7 +496,7 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
                 };
 
                 class Mul: public Expr {
@@ -420,7 +505,7 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
                 };
 
                 class Div: public Expr {
@@ -429,7 +514,7 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
                 };
 
                 class Mod: public Expr {
@@ -438,7 +523,7 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
                 };
 
                 class And: public Expr {
@@ -447,7 +532,7 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
                 };
 
                 class Or: public Expr {
@@ -456,7 +541,7 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
                 };
 
                 class Xor: public Expr {
@@ -465,7 +550,7 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
                 };
 
                 class Shl: public Expr {
@@ -474,7 +559,7 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
                 };
 
                 class Shr: public Expr {
@@ -483,7 +568,7 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
                 };
 
                 class Sar: public Expr {
@@ -492,7 +577,7 @@ public:
 
                     std::string to_string() const override;
 
-                    riscv_trans::Register rvalue_to_riscv(std::string& str) const override;
+                    riscv_trans::Register rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const override;
                 };
 
             class FuncCall: public Rvalue, public NotEndStmt {
@@ -500,17 +585,20 @@ public:
                 std::string to_string() const override;
 
                 void stmt_to_riscv(
-                    std::string& str, 
+                    riscv_trans::MachineModule& module, 
                     riscv_trans::TransMode trans_mode
                 ) const override;
 
                 riscv_trans::Register rvalue_to_riscv(
-                    std::string& str
+                    riscv_trans::MachineBasicBlock& mbb
                 ) const override;
 
                 bool is_func_call() const override;
                 unsigned get_func_call_param_n() const override;
 
+                std::vector<Id*> get_used_ids() const override;
+                void replace_uses(const std::unordered_map<Id*, Value*>& values) override;
+
                 FuncCall(Id* id, std::vector<Value*> args);
 
                 Id* get_id() const;
@@ -526,13 +614,17 @@ public:
             std::string to_string() const override;
 
             void stmt_to_riscv(
-                std::string& str, 
+                riscv_trans::MachineModule& module, 
                 riscv_trans::TransMode trans_mode
             ) const override;
 
             bool is_func_call() const override;
             unsigned get_func_call_param_n() const override;
 
+            std::vector<Id*> get_used_ids() const override;
+            Id* get_def_id() const override;
+            void replace_uses(const std::unordered_map<Id*, Value*>& values) override;
+
             SymbolDef(Id* id, Rvalue* val);
 
             Rvalue* get_val() const;
@@ -552,10 +644,16 @@ public:
                 std::string to_string() const override;
 
                 void stmt_to_riscv(
-                    std::string& str, 
+                    riscv_trans::MachineModule& module, 
                     riscv_trans::TransMode trans_mode
                 ) const override;
 
+                std::vector<Id*> get_used_ids() const override;
+                void replace_uses(const std::unordered_map<Id*, Value*>& values) override;
+
+                Value* get_value() const;
+                Id* get_addr() const;
+
             private:
                 Value* value;
                 Id* addr;
@@ -566,12 +664,17 @@ public:
                 std::string to_string() const override;
 
                 void stmt_to_riscv(
-                    std::string& str, 
+                    riscv_trans::MachineModule& module, 
                     riscv_trans::TransMode trans_mode
                 ) const override;
 
                 StoreInitializer(Initializer* initializer, Id* addr);
 
+                std::vector<Id*> get_used_ids() const override;
+                void replace_uses(const std::unordered_map<Id*, Value*>& values) override;
+
+                Id* get_addr() const;
+
             private:
                 Initializer* initializer;
                 Id* addr;
@@ -586,16 +689,29 @@ public:
             std::string to_string() const override;
 
             void stmt_to_riscv(
-                std::string& str, 
+                riscv_trans::MachineModule& module, 
                 riscv_trans::TransMode trans_mode
             ) const override;
 
             Branch(Value* cond, Label target1, Label target2);
 
+            std::vector<Id*> get_used_ids() const override;
+            std::vector<Label> get_target_labels() const override;
+            void replace_uses(const std::unordered_map<Id*, Value*>& values) override;
+
+            Value* get_cond() const;
+            /* redirect the `index`-th target, 0 for `target1` */
+            void set_target_label(int index, Label label);
+            /* values passed to the parameters of the `index`-th target */
+            std::vector<Value*> get_target_args(int index) const;
+            void set_target_args(int index, std::vector<Value*> args);
+
         private:
             Value* cond;
             Label target1;
             Label target2;
+            std::vector<Value*> args1;
+            std::vector<Value*> args2;
         };
 
         class Jump: public EndStmt {
@@ -603,14 +719,25 @@ public:
             std::string to_string() const override;
 
             void stmt_to_riscv(
-                std::string& str, 
+                riscv_trans::MachineModule& module, 
                 riscv_trans::TransMode trans_mode
             ) const override;
             
-            Jump(Label target);
+            /**
+             * @param args  values passed to the parameters of the target block
+             */
+            Jump(Label target, std::vector<Value*> args = {});
+
+            std::vector<Id*> get_used_ids() const override;
+            std::vector<Label> get_target_labels() const override;
+            void replace_uses(const std::unordered_map<Id*, Value*>& values) override;
+
+            std::vector<Value*> get_args() const;
+            void set_args(std::vector<Value*> args);
 
         private:
             Label target;
+            std::vector<Value*> args;
         };
 
 
@@ -621,12 +748,18 @@ public:
             std::string to_string() const override;
 
             void stmt_to_riscv(
-                std::string& str, 
+                riscv_trans::MachineModule& module, 
                 riscv_trans::TransMode trans_mode
             ) const override;
 
             Return();
             Return(Value* val);
+
+            std::vector<Id*> get_used_ids() const override;
+            void replace_uses(const std::unordered_map<Id*, Value*>& values) override;
+
+            /* nullptr if nothing is returned */
+            Value* get_val() const;
         
         private:
             ReturnType return_type;
@@ -645,15 +778,21 @@ public:
 
             std::string to_string() const override;
 
-            void block_to_riscv(std::string& str) const;
+            void block_to_riscv(riscv_trans::MachineModule& module) const;
 
             Block(Label label, std::vector<Stmt*> stmts);
 
             Label get_label() const;
             std::vector<Stmt*>& get_stmts();
+            /*
+             * parameters of the block, taking the values passed by the jumps
+             * to it in place of phi nodes. the entry block has none
+             */
+            std::vector<Id*>& get_params();
 
         private:
             Label label;
+            std::vector<Id*> params;
             std::vector<Stmt*> stmts;
         };
 
@@ -668,7 +807,7 @@ public:
             std::string func_decl_to_string_agent() const;
 
             void stmt_to_riscv(
-                std::string& str, 
+                riscv_trans::MachineModule& module, 
                 riscv_trans::TransMode trans_mode
             ) const override;
 
@@ -680,7 +819,8 @@ public:
 
             Id* get_id() const;
             std::vector<Id*> get_formal_param_ids() const;
-            std::vector<Block*> get_blocks() const;
+            const std::vector<Block*>& get_blocks() const;
+            void set_blocks(std::vector<Block*> blocks);
 
         private:
             Id* id;
@@ -693,7 +833,7 @@ public:
             std::string to_string() const override;
 
             void stmt_to_riscv(
-                std::string& str, 
+                riscv_trans::MachineModule& module, 
                 riscv_trans::TransMode trans_mode
             ) const override;
 
@@ -711,15 +851,20 @@ public:
             std::string to_string() const override;
 
             void stmt_to_riscv(
-                std::string& str, 
+                riscv_trans::MachineModule& module, 
                 riscv_trans::TransMode trans_mode
             ) const override;
 
             GlobalMemoryDecl(Type* type, Initializer* initializer);
 
+            /* memory of a `const` array, never written to */
+            void set_read_only();
+            bool is_read_only() const;
+
         private:
             Type* type;
             Initializer* initializer;
+            bool is_read_only_bool { false };
         };
 
         class GlobalSymbolDef: public GlobalStmt {
@@ -727,12 +872,14 @@ public:
             std::string to_string() const override;
 
             void stmt_to_riscv(
-                std::string& str, 
+                riscv_trans::MachineModule& module, 
                 riscv_trans::TransMode trans_mode
             ) const override;
 
             GlobalSymbolDef(Id* id, GlobalMemoryDecl* decl);
 
+            GlobalMemoryDecl* get_decl() const;
+
         private:
             Id* id;
             GlobalMemoryDecl* decl;
@@ -746,6 +893,8 @@ public:
 
     Program(std::vector<GlobalStmt*> global_stmts);
 
+    std::vector<GlobalStmt*> get_global_stmts() const;
+
 private:
     std::vector<GlobalStmt*> global_stmts;
 };
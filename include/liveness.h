@@ -0,0 +1,42 @@
+#ifndef LIVENESS_H_
+#define LIVENESS_H_
+
+#include "dataflow.h"
+
+namespace dataflow {
+
+    /*
+     * identifiers live at the boundaries of each block of a function,
+     * as bit sets over `numbering`
+     */
+    struct Liveness {
+        FlowGraph graph;
+        ValueNumbering numbering;
+        std::vector<BitSet> live_in;
+        std::vector<BitSet> live_out;
+    };
+
+    /**
+     * @return  identifiers `stmt` of `block` defines: its result, or the
+     *          parameters of the block a `jump` passes arguments to, all
+     *          assigned at once on leaving. The edges of a `br` passing
+     *          arguments are expected to have been split, but for those
+     *          `riscv_trans::split_arg_edges` keeps, defining the parameters
+     *          of the target they pass arguments to
+     */
+    std::vector<koopa::Id*> get_def_ids(const FlowGraph& graph, int block, const koopa::Stmt* stmt);
+
+    /**
+     * backward union problem: a block generates the identifiers it reads
+     * before defining them and kills the ones it defines
+     *
+     * @return  liveness of `ids` in `func_def`; other identifiers are ignored
+     */
+    Liveness analyze_liveness(
+        const koopa::FuncDef* func_def,
+        const std::vector<koopa::Id*>& ids
+    );
+
+}
+
+#endif
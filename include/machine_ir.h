@@ -0,0 +1,233 @@
+#ifndef MACHINE_IR_H_
+#define MACHINE_IR_H_
+
+#include "riscv_trans.h"
+
+#include <initializer_list>
+#include <string>
+#include <vector>
+
+/*
+ * in-memory form of the generated riscv assembly
+ *
+ * koopa statements are lowered into `MachineInstr`s appended to the
+ * `MachineBasicBlock` of their block, and the whole `MachineModule` is
+ * printed once when the translation is done, so that passes may rewrite the
+ * instructions in between.
+ */
+namespace riscv_trans {
+
+    enum class Opcode: unsigned char {
+        Li, La, Mv,
+        Add, Addi, Sub, Mul, Mulh, Div, Rem,
+        And, Andi, Or, Ori, Xor, Xori,
+        Sll, Slli, Srl, Srli, Sra, Srai,
+        Sh1add, Sh2add, Sh3add,     // Zba
+        Min, Max,                   // Zbb
+        Slt, Slti, Sgt, Seqz, Snez,
+        Lw, Sw,
+        Bnez, Beqz, Beq, Bne, Blt, Bge, J, Call, Tail, Ret,
+        Comment     // not an instruction, `# symbol` in debug mode
+    };
+
+    /**
+     * @return   assembly mnemonic of `opcode`
+     * @example  get_opcode_name(Opcode::Addi) => "addi"
+     */
+    const char* get_opcode_name(Opcode opcode);
+
+    /**
+     * @return   opcode taking an immediate as its last operand instead of a
+     *           register, `opcode` itself if there is none
+     * @example  get_i_type_opcode(Opcode::Add) => Opcode::Addi
+     */
+    Opcode get_i_type_opcode(Opcode opcode);
+
+    /**
+     * @return   whether `opcode` branches to its last operand or falls through
+     * @example  is_cond_branch(Opcode::Blt) => true
+     */
+    bool is_cond_branch(Opcode opcode);
+
+    /**
+     * @return   conditional branch taken exactly when `opcode` is not, on the
+     *           same operands
+     * @example  get_inverse_branch(Opcode::Blt) => Opcode::Bge
+     */
+    Opcode get_inverse_branch(Opcode opcode);
+
+    class MachineOperand {
+    public:
+        enum class Kind: unsigned char { None, Reg, Imm, Symbol, Mem };
+
+        MachineOperand();
+        MachineOperand(Register reg);
+        MachineOperand(int imm);
+        /*
+         * label, function or global variable, interned so that operands stay
+         * small
+         */
+        MachineOperand(std::string symbol);
+
+        /**
+         * @example  mem(4, Register("sp")) => `4(sp)`
+         */
+        static MachineOperand mem(int offset, Register base);
+
+        Kind get_kind() const;
+        /* register of `Reg`, base register of `Mem` */
+        Register get_reg() const;
+        /* value of `Imm`, offset of `Mem` */
+        int get_imm() const;
+        const std::string& get_symbol() const;
+
+        void print(std::string& str) const;
+
+    private:
+        Kind kind;
+        unsigned char reg;
+        int imm;
+        const std::string* symbol;
+    };
+
+    /*
+     * an instruction has at most three operands, kept inline
+     */
+    class MachineInstr {
+    public:
+        static constexpr int MAX_OPERAND_N = 3;
+
+        MachineInstr(Opcode opcode, std::initializer_list<MachineOperand> operands = {});
+
+        Opcode get_opcode() const;
+        void set_opcode(Opcode opcode);
+        int get_operand_n() const;
+        MachineOperand& get_operand(int i);
+        const MachineOperand& get_operand(int i) const;
+
+        /**
+         * registers read and written by the instruction. `call` and `ret`
+         * are left to the users, whose conventions differ
+         *
+         * @return   whether the instruction writes its first operand
+         */
+        bool has_def() const;
+        Register get_def() const;
+        std::vector<Register> get_uses() const;
+
+        /*
+         * printed in its 16-bit RVC form, see `compress.h`
+         */
+        bool is_compressed() const;
+        void set_compressed(bool is_compressed);
+
+        /**
+         * append the instruction as a line of assembly to `str`
+         * @example  `    addi    a0, t1, 1`
+         */
+        void print(std::string& str) const;
+        std::string to_string() const;
+
+    private:
+        Opcode opcode;
+        unsigned char operand_n;
+        bool is_compressed_bool { false };
+        MachineOperand operands[MAX_OPERAND_N];
+    };
+
+    class MachineBasicBlock {
+    public:
+        friend void operator+=(MachineBasicBlock& self, MachineInstr instr);
+
+        friend void operator+=(MachineBasicBlock& self, std::vector<MachineInstr> instrs);
+
+        MachineBasicBlock(std::string label);
+
+        std::string get_label() const;
+        std::vector<MachineInstr>& get_instrs();
+        const std::vector<MachineInstr>& get_instrs() const;
+
+        void print(std::string& str) const;
+
+    private:
+        std::string label;
+        std::vector<MachineInstr> instrs;
+    };
+
+    /*
+     * the first block is labelled with the function name and holds the
+     * prologue, then come the blocks of the koopa function in order
+     */
+    class MachineFunction {
+    public:
+        MachineFunction(std::string name);
+
+        std::string get_name() const;
+        std::vector<MachineBasicBlock>& get_blocks();
+        const std::vector<MachineBasicBlock>& get_blocks() const;
+
+        void print(std::string& str) const;
+
+    private:
+        std::string name;
+        std::vector<MachineBasicBlock> blocks;
+    };
+
+    /*
+     * a global variable in the data segment, as a sequence of `.word` and
+     * `.zero` directives
+     */
+    class MachineGlobal {
+    public:
+        struct Directive {
+            enum class Kind { Word, Zero } kind;
+            int val;
+        };
+
+        /* `.bss` holds globals of nothing but zeros, `.rodata` const arrays */
+        enum class Section { Data, Bss, Rodata };
+
+        MachineGlobal(std::string name, std::string comment = {});
+
+        std::string get_name() const;
+        std::vector<Directive>& get_directives();
+
+        Section get_section() const;
+        void set_section(Section section);
+        /* log2 of the alignment in bytes, 2 by default */
+        void set_align(int align);
+
+        void print(std::string& str) const;
+
+    private:
+        std::string name;
+        std::string comment;
+        std::vector<Directive> directives;
+        Section section { Section::Data };
+        int align { 2 };
+    };
+
+    class MachineModule {
+    public:
+        /*
+         * append the whole assembly to `str`
+         */
+        void print(std::string& str) const;
+
+        std::vector<MachineGlobal>& get_globals();
+        std::vector<MachineFunction>& get_functions();
+
+        /**
+         * @return  last block of the last function, which the statements of
+         *          the koopa block being translated are appended to
+         */
+        MachineBasicBlock& get_insert_block();
+
+    private:
+        std::vector<MachineGlobal> globals;
+        std::vector<MachineFunction> functions;
+    };
+
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef MEM2REG_H_
+#define MEM2REG_H_
+
+#include "koopa.h"
+
+/*
+ * promotion of local scalars from memory to SSA values
+ *
+ * the front end gives every local scalar and formal parameter an `alloc`,
+ * storing to and loading from it. An `alloc` of an `i32` or a pointer whose
+ * address is only ever loaded from and stored to is removed with its loads
+ * and stores, each load replaced by the value stored last on the way to it.
+ * Where stores on different paths meet, at the iterated dominance frontier
+ * of the blocks storing to it and only if it is still read from there, the
+ * block takes a parameter instead of a phi node, and every jump to it passes
+ * the value reaching the end of the jumping block, a `br` passing them along
+ * each of its edges. Unreachable blocks are removed first, and a value read
+ * before any store is 0.
+ */
+namespace koopa_opt {
+
+    /*
+     * whether the pipelines of `pass_manager.h` promote scalars, cleared by
+     * `-no-mem2reg`
+     */
+    extern bool enable_mem2reg;
+
+    /**
+     * @return  whether `func_def` changed
+     */
+    bool mem2reg(koopa::FuncDef* func_def);
+
+}
+
+#endif
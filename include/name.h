@@ -3,8 +3,10 @@
 
 #include "koopa.h"
 #include "def.h"
+#include "machine_ir.h"
 
 #include <string>
+#include <vector>
 
 /**
  * @example  `%LLB_1` `%4`
@@ -24,49 +26,35 @@ std::string align(std::string str, int n = 8);
 std::string to_riscv_style(std::string symbol);
 
 /**
- * add `\t` at the beginning, assign `op_code` to 8 characters long,
- * add comma between each two operands, add space after comma.
- * 
- * @param is_i_type_inst  turn `op_code` to i-type instruction
- * @example  build_inst("add", "a0", "t1", "1", true)
- *              -> `    addi    a0, t1, 1` 
+ * @return  the source koopa line as a comment if `debug_mode_riscv` is true,
+ *          nothing otherwise
  */
-std::string build_inst(std::string op_code, 
-    std::string r1 = {}, std::string r2 = {}, std::string r3 = {}, 
-    bool is_i_type_inst = false
-);
-
-/**
- * @example  build_mem(4, Register("sp")) => "4(sp)"
- */
-std::string build_mem(
-    int offset, 
-    riscv_trans::Register base_addr = riscv_trans::Register("sp")
-);
-
-/**
- * @return  string form of the source koopa line if in `debug_mode_riscv` is true
- */
-std::string build_comment(const koopa::Base* obj);
+std::vector<riscv_trans::MachineInstr> build_comment(const koopa::Base* obj);
 
 /**
  * handling `offset` beyond the IMM12 range
- * @example  build_sw_lw(lw, t0, 4) =>  
+ * @example  build_sw_lw(Opcode::Lw, t0, 4) =>  
  *      lw      t0, 4(sp)
- * @example  build_sw_lw(lw, t0, 10000) =>
+ * @example  build_sw_lw(Opcode::Lw, t0, 10000) =>
  *      li      t1, 10000
  *      add     t1, t1, sp
  *      lw      t0, 0(t1)   
  */
-std::string build_sw_lw(
-    std::string inst,
+std::vector<riscv_trans::MachineInstr> build_sw_lw(
+    riscv_trans::Opcode opcode,
     riscv_trans::Register val_reg, 
     int offset, 
     riscv_trans::Register addr_reg = riscv_trans::Register("sp")
 );
 
-std::string build_i_type_inst(
-    std::string inst, 
+/**
+ * the immediate form of `opcode` if `second_val` fits in IMM12, otherwise
+ * `second_val` is loaded into a scratch register first
+ * @example  build_i_type_inst(Opcode::Add, a0, t1, 1) =>
+ *      addi    a0, t1, 1
+ */
+std::vector<riscv_trans::MachineInstr> build_i_type_inst(
+    riscv_trans::Opcode opcode, 
     riscv_trans::Register target_reg,
     riscv_trans::Register first_reg, 
     int second_val
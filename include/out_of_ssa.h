@@ -0,0 +1,62 @@
+#ifndef OUT_OF_SSA_H_
+#define OUT_OF_SSA_H_
+
+#include "koopa.h"
+
+#include <functional>
+#include <vector>
+
+/*
+ * leaving SSA form in the backend, block parameters assigned by the jumps
+ *
+ * a `jump` passing arguments copies them into the parameters of its target
+ * all at once. The copies are done one after another in an order in which
+ * none overwrites a location another has yet to read; only the locations of
+ * a cycle cannot be ordered so, and one of them is saved into a scratch
+ * register first. The allocators try to give a parameter and its arguments
+ * the same location, see `graph_coloring.cpp` and `linear_scan.cpp`, in
+ * which case the copy is gone.
+ *
+ * a `br` has no room for the copies of its edges, so each of its edges
+ * passing arguments, which is critical whenever the target has another
+ * predecessor, is split by a block of its own with a `jump` doing them.
+ * Liveness then takes every parameter as defined by the `jump`s to its block,
+ * see `dataflow::get_def_ids`. A `br` lowered into something else that sets
+ * the parameters of its target itself, as a Zbb `max` or `min`, keeps its
+ * arguments instead.
+ */
+namespace riscv_trans {
+
+    /*
+     * move the arguments of each edge of a `br` of `func_def` into a block
+     * placed right after that of the `br`, jumping on to the target, but for
+     * the `br`s `is_kept` holds for
+     */
+    void split_arg_edges(
+        koopa::FuncDef* func_def,
+        const std::function<bool(const koopa::Branch*)>& is_kept
+    );
+
+    /*
+     * a copy from location `src` into location `dst`, locations numbered by
+     * the caller
+     */
+    struct Copy {
+        int dst;
+        int src;
+    };
+
+    /**
+     * @param copies   done at once, each into a distinct location
+     * @param scratch  location none of `copies` touches
+     * @return  `copies` one after another, with the copy of a location of
+     *          a cycle into `scratch` inserted before it is overwritten, the
+     *          copies reading that location reading `scratch` instead
+     * @example  sequentialize_copies({ {1, 2}, {2, 1}, {3, 1} }, 0)
+     *           => { {3, 1}, {0, 1}, {1, 2}, {2, 0} }
+     */
+    std::vector<Copy> sequentialize_copies(std::vector<Copy> copies, int scratch);
+
+}
+
+#endif
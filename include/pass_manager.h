@@ -0,0 +1,74 @@
+#ifndef PASS_MANAGER_H_
+#define PASS_MANAGER_H_
+
+#include "koopa.h"
+
+#include <string>
+#include <vector>
+
+/*
+ * optimization passes over koopa IR, run between `ast->to_koopa()` and the
+ * output
+ *
+ * a function pass runs on each function definition in turn, a module pass
+ * on the program as a whole. Each returns whether it changed anything, and
+ * a change drops the analyses the pass does not preserve, for now the
+ * `dataflow::Cfg` of the function, see `cfg.h`. The copies of the functions
+ * printed in place of an earlier declaration are brought up to date after
+ * each function pass.
+ *
+ * the passes run are the pipeline of the optimization level, unless
+ * `-passes=` names them itself, in order.
+ */
+namespace koopa_opt {
+
+    enum class PassKind { Function, Module };
+
+    struct Pass {
+        std::string name;
+        PassKind kind;
+        bool (*run_on_func)(koopa::FuncDef* func_def);
+        bool (*run_on_program)(koopa::Program* program);
+        /* whether the cached graph still holds after a change, or the pass keeps it up to date itself */
+        bool preserves_cfg;
+    };
+
+    /**
+     * @return  the pass named `name`
+     * @throw   <compiler_exception> if there is none
+     */
+    const Pass& get_pass(const std::string& name);
+
+    /**
+     * @return  names of the passes run at `opt_level`: none at 0, the
+     *          promotion of scalars to SSA values at 1, and the optimizations
+     *          over them as well at 2
+     */
+    std::vector<std::string> get_pipeline(int opt_level);
+
+    /*
+     * set by `-O0` to `-O2`, 2 by default
+     *
+     * @throw  <compiler_exception> if `level` is not one of them
+     */
+    void set_opt_level(std::string level);
+
+    /*
+     * run the passes named in comma-separated `names` instead of a pipeline,
+     * set by `-passes=`
+     *
+     * @throw  <compiler_exception> if one of them does not exist
+     */
+    void set_passes(std::string names);
+
+    /*
+     * run the passes on `program`, reporting the wall time each takes and
+     * the size of the program before and after it to stderr if
+     * `debug_mode_time_passes`
+     * @example  `mem2reg: 0.412 ms, 15 blocks 230 stmts -> 15 blocks 168 stmts`
+     */
+    void run_passes(koopa::Program* program);
+
+}
+
+#endif
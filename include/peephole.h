@@ -0,0 +1,28 @@
+#ifndef PEEPHOLE_H_
+#define PEEPHOLE_H_
+
+#include "machine_ir.h"
+
+namespace riscv_trans {
+
+    /*
+     * whether `run_peephole` is applied before printing, cleared by
+     * `-no-peephole`
+     */
+    extern bool enable_peephole;
+
+    /*
+     * rewrite short windows of instructions of `func` with the rules of
+     * `peephole.cpp`, and drop jumps to the block laid out next
+     */
+    void run_peephole(MachineFunction& func);
+
+    /*
+     * print how many times each rule fired over the whole program to stderr
+     * @example  `peephole: fold-mv 1024`
+     */
+    void report_peephole_counts();
+
+}
+
+#endif
@@ -14,6 +14,7 @@ namespace koopa {
     class Label;
     class GlobalStmt;
     class FuncDef;
+    class FuncCall;
 }
 
 namespace riscv_trans {
@@ -23,6 +24,8 @@ namespace riscv_trans {
     bool is_within_imm12_range(int x);
 
     class Register;
+    class MachineBasicBlock;
+    class MachineModule;
     /*
      * storage location in riscv of koopa identifier,
      * at register, data segment or memory.
@@ -38,9 +41,9 @@ namespace riscv_trans {
          * ! freeing the save address register in the back, etc.) It is worth it,
          * ! otherwise it may require a lot of effort to reconstruct the system.
          */
-        virtual Register get(std::string& str) = 0;
-        virtual void save(std::string& str, Register source_reg) = 0;
-        virtual Register get_addr(std::string& str);
+        virtual Register get(MachineBasicBlock& mbb) = 0;
+        virtual void save(MachineBasicBlock& mbb, Register source_reg) = 0;
+        virtual Register get_addr(MachineBasicBlock& mbb);
 
         /**
          * @return   the literal of the value
@@ -84,13 +87,24 @@ namespace riscv_trans {
          */
         Register(std::string lit);
         
-        Register get(std::string& str) override;
-        void save(std::string& str, Register source_reg) override;
+        Register get(MachineBasicBlock& mbb) override;
+        void save(MachineBasicBlock& mbb, Register source_reg) override;
 
         std::string get_lit() override;
 
         int get_serial_num();
 
+        /**
+         * @return   whether the register is s1-s11, which a function must
+         *           restore before returning if it writes to them
+         */
+        bool is_callee_saved();
+        /**
+         * @return   whether the register is x8-x15, the ones most RVC
+         *           instructions are able to name
+         */
+        bool is_compressible();
+
     private:
         int serial_num;
     };
@@ -101,9 +115,9 @@ namespace riscv_trans {
         DataSeg();
         DataSeg(std::string lit);
 
-        Register get(std::string& str) override;
-        void save(std::string& str, Register source_reg) override;
-        Register get_addr(std::string& str) override;
+        Register get(MachineBasicBlock& mbb) override;
+        void save(MachineBasicBlock& mbb, Register source_reg) override;
+        Register get_addr(MachineBasicBlock& mbb) override;
 
         std::string get_lit() override;
 
@@ -117,9 +131,9 @@ namespace riscv_trans {
         StackFrame();
         StackFrame(int offset);
 
-        Register get(std::string& str) override;
-        void save(std::string& str, Register source_reg) override;
-        Register get_addr(std::string& str) override;
+        Register get(MachineBasicBlock& mbb) override;
+        void save(MachineBasicBlock& mbb, Register source_reg) override;
+        Register get_addr(MachineBasicBlock& mbb) override;
 
         int get_offset();
 
@@ -127,6 +141,10 @@ namespace riscv_trans {
         int offset;
     };
 
+    /*
+     * hands out t0-t2 as scratch registers while translating a single
+     * koopa statement; t3-t6 are left to the register allocator
+     */
     class TempRegManager {
     public:
         TempRegManager();
@@ -137,9 +155,13 @@ namespace riscv_trans {
          * do nothing if it's not.
          */
         void refresh_reg(Register reg);
+        /*
+         * whether `reg` is one of the registers handed out here
+         */
+        bool is_temp_reg(Register reg);
 
     private:
-        static constexpr int TEMP_REG_COUNT = 7;
+        static constexpr int TEMP_REG_COUNT = 3;
         bool is_used[TEMP_REG_COUNT];
     };
     extern TempRegManager temp_reg_manager;
@@ -170,13 +192,88 @@ namespace riscv_trans {
      * if it's true, save ra at the stack frame
      */
     extern bool current_has_called_func;
+    /*
+     * callee-saved registers allocated in function currently at, saved in
+     * the prologue and restored before each `ret`, in slots right below ra
+     */
+    extern std::vector<Register> current_saved_regs;
+    /*
+     * identifiers of function currently at folded into the addresses of their
+     * users by `lower_addresses`, which are never materialized and obtain
+     * no storage location
+     */
+    extern std::unordered_set<const koopa::Id*> current_folded_ids;
+    /*
+     * calls of function currently at right before a `ret` of their result,
+     * which jump to the callee with the stack frame torn down instead. they
+     * neither make the function save ra nor need the outgoing argument area
+     */
+    extern std::unordered_set<const koopa::Stmt*> current_tail_calls;
+    /*
+     * whether calls in tail position are lowered as above, cleared by
+     * `-no-tail-call`
+     */
+    extern bool enable_tail_call;
+    /*
+     * identifiers of function currently at left in caller-saved registers
+     * while live across a call, by the calls they are live across. The call
+     * stores them into their `current_save_slots` before and loads them back
+     * after itself, so only what is live is saved
+     */
+    extern std::unordered_map<const koopa::FuncCall*, std::vector<const koopa::Id*>> current_call_saved_ids;
+    extern std::unordered_map<const koopa::Id*, int> current_save_slots;
+    /*
+     * a stack frame beyond the IMM12 range of `sp` has `fp` point at
+     * `current_anchor_offset(sp)` from the prologue on, chosen to bring as
+     * many accesses past that range as possible within the IMM12 range of
+     * `fp`, and saves `fp` with the callee-saved registers. 0 if there is no
+     * anchor, always so with `-no-frame-anchor`
+     */
+    extern int current_anchor_offset;
+    extern bool enable_frame_anchor;
+
+    /*
+     * extensions beyond RV32IM the output may use, set by `-march=`. Zba
+     * scales array indexes by `sh1add`-`sh3add` and multiplies by constants
+     * with them, Zbb lowers `if (x > m) m = x;` and the like to `max` or `min`
+     */
+    extern bool enable_zba;
+    extern bool enable_zbb;
+    /*
+     * whether the base is rv32imc, the output then using the RVC forms of
+     * instructions where they fit, see `compress.h`
+     */
+    extern bool enable_rvc;
+
+    /*
+     * parse `march` such as `rv32im_zba_zbb` into the flags above
+     *
+     * @throw  <compiler_exception> if the base is not rv32im or rv32imc, or
+     *         an extension is not supported
+     */
+    void set_target_arch(std::string march);
+
+    /**
+     * @return  register to address `offset(sp)` of the stack frame from, `fp`
+     *          with `offset` made relative to it if only the anchor reaches it
+     */
+    Register get_frame_base(int& offset);
+
+    enum class RegAllocStrategy {
+        Naive,          // every identifier lives on the stack frame
+        LinearScan,     // live intervals scanned in order, see `linear_scan.cpp`
+        GraphColoring   // Chaitin-Briggs with coalescing, see `graph_coloring.cpp`
+    };
+    /*
+     * strategy used by `allocate_ids_storage_location`, set by `-regalloc=`
+     */
+    extern RegAllocStrategy reg_alloc_strategy;
 
     /*
      * allocate storage location for identifier & formal parameters
      * of `func_def`
      *
-     * implemented in `allocate.cpp`, an interface reserved for future 
-     * register allocation algorithms
+     * implemented in `allocate.cpp`, dispatching on `reg_alloc_strategy`
      */
     void allocate_ids_storage_location(const koopa::FuncDef* func_def);
 
@@ -0,0 +1,41 @@
+#ifndef SCCP_H_
+#define SCCP_H_
+
+#include "koopa.h"
+
+/*
+ * sparse conditional constant propagation over the SSA form
+ *
+ * every `i32` value a function defines, by an expression or as a parameter
+ * of a block, is given a lattice value: undefined until shown otherwise, a
+ * constant, or overdefined. Starting from the entry, only the edges a
+ * terminator may take are followed, a `br` on a constant taking just one,
+ * and a parameter meets the arguments passed along the edges followed to
+ * its block. A value that changes revisits the statements reading it, so the
+ * values of a loop settle without walking it again and again.
+ *
+ * afterwards the constant values replace their uses, and their expressions
+ * and parameters are removed along with the arguments passed to them. A
+ * `br` on a constant becomes a `jump` to the target it takes, with the
+ * arguments of that target, and the blocks never reached are removed, e.g.
+ * whatever `if (DEBUG)` guards where `const int DEBUG = 0;`. What is left
+ * in a row is then merged: a block reached along a single edge takes the
+ * arguments passed along it for its parameters, and is appended to the block
+ * jumping to it. A division by zero is left for the run time.
+ */
+namespace koopa_opt {
+
+    /*
+     * whether the `-O2` pipeline of `pass_manager.h` propagates constants,
+     * cleared by `-no-sccp`
+     */
+    extern bool enable_sccp;
+
+    /**
+     * @return  whether `func_def` changed
+     */
+    bool sccp(koopa::FuncDef* func_def);
+
+}
+
+#endif
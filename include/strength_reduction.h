@@ -0,0 +1,72 @@
+#ifndef STRENGTH_REDUCTION_H_
+#define STRENGTH_REDUCTION_H_
+
+#include "machine_ir.h"
+
+/*
+ * multiplication, division and modulo by a constant
+ *
+ * each operation has a few candidate sequences, such as shifts and adds for
+ * `mul`, bias and shift for division by a power of 2, or `mulh` by a magic
+ * number for the other divisors, besides the plain instruction. The one with
+ * the least cost estimated by `get_cost` is emitted.
+ */
+namespace riscv_trans {
+
+    /*
+     * estimated cycles of `instrs`, taking `mul` and `mulh` as `MUL_COST`,
+     * `div` and `rem` as `DIV_COST`, `li` beyond IMM12 as 2 and the others as 1
+     */
+    constexpr int MUL_COST = 3;
+    constexpr int DIV_COST = 20;
+    int get_cost(const std::vector<MachineInstr>& instrs);
+
+    /**
+     * @return   `k` if `x` is `2^k`, -1 otherwise
+     * @example  get_log2(8) => 3
+     */
+    int get_log2(unsigned x);
+
+    /**
+     * @return   Zba `shNadd` scaling by `stride`, `add` if there is none
+     * @example  get_sh_add_opcode(4) => Opcode::Sh2add
+     */
+    Opcode get_sh_add_opcode(int stride);
+
+    /**
+     * `target = source * val`, `target` and `source` being different registers
+     * @example  mul_by_const_to_riscv(mbb, t1, t0, 10) =>
+     *      slli    t1, t0, 2
+     *      add     t1, t1, t0
+     *      slli    t1, t1, 1
+     */
+    void mul_by_const_to_riscv(MachineBasicBlock& mbb, Register target, Register source, int val);
+
+    /**
+     * `target = source * val` by the `shNadd`s of Zba and a shift, which
+     * need no other register, so `target` may be `source`
+     * @return   false, emitting nothing, unless `val` is positive and has no
+     *           factors but 2, 3, 5 and 9
+     * @example  sh_add_mul_to_riscv(mbb, t0, t0, 40) =>
+     *      sh2add  t0, t0, t0
+     *      slli    t0, t0, 3
+     */
+    bool sh_add_mul_to_riscv(MachineBasicBlock& mbb, Register target, Register source, int val);
+
+    /**
+     * `target = source / val`, rounding toward zero
+     * @example  div_by_const_to_riscv(mbb, t1, t0, 2) =>
+     *      srli    t1, t0, 31
+     *      add     t1, t1, t0
+     *      srai    t1, t1, 1
+     */
+    void div_by_const_to_riscv(MachineBasicBlock& mbb, Register target, Register source, int val);
+
+    /*
+     * `target = source % val`, taking the sign of `source`
+     */
+    void rem_by_const_to_riscv(MachineBasicBlock& mbb, Register target, Register source, int val);
+
+}
+
+#endif
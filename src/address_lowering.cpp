@@ -0,0 +1,303 @@
+#include "address_lowering.h"
+#include "strength_reduction.h"
+
+#include <cassert>
+#include <optional>
+#include <unordered_map>
+
+namespace riscv_trans {
+
+/*
+ * `base + index * stride` of `getelemptr` and `getptr`
+ */
+struct PtrArith {
+    koopa::Id* base;
+    koopa::Value* index;
+    int stride;
+};
+
+static std::optional<PtrArith> get_ptr_arith(koopa::Rvalue* val) {
+    if (auto* get_elem_ptr { dynamic_cast<koopa::GetElemPtr*>(val) }) {
+        return PtrArith {
+            get_elem_ptr->get_base(), get_elem_ptr->get_offset(),
+            static_cast<int>(get_elem_ptr->get_stride())
+        };
+    }
+    if (auto* get_ptr { dynamic_cast<koopa::GetPtr*>(val) }) {
+        return PtrArith {
+            get_ptr->get_base(), get_ptr->get_offset(),
+            static_cast<int>(get_ptr->get_stride())
+        };
+    }
+    return std::nullopt;
+}
+
+/**
+ * @return  identifier `stmt` reads as the address to load from or store to,
+ *          or as the base of address arithmetic, nullptr if there is none
+ */
+static koopa::Id* get_addr_use(koopa::Stmt* stmt) {
+    if (auto* store_value { dynamic_cast<koopa::StoreValue*>(stmt) }) {
+        return store_value->get_addr();
+    }
+    if (auto* store_initializer { dynamic_cast<koopa::StoreInitializer*>(stmt) }) {
+        return store_initializer->get_addr();
+    }
+    if (auto* symbol_def { dynamic_cast<koopa::SymbolDef*>(stmt) }) {
+        if (auto* load { dynamic_cast<koopa::Load*>(symbol_def->get_val()) }) {
+            return load->get_addr();
+        }
+        if (auto ptr_arith { get_ptr_arith(symbol_def->get_val()) }) {
+            return ptr_arith->base;
+        }
+    }
+    return nullptr;
+}
+
+/*
+ * of the function currently at, pointer declared by `alloc` to its pseudo id,
+ * and folded `getelemptr` or `getptr` to its operands
+ */
+static std::unordered_map<const koopa::Id*, koopa::Id*> alloc_pseudo_ids;
+static std::unordered_map<const koopa::Id*, PtrArith> folded_ptr_ariths;
+
+/*
+ * append `stmts[i]` to `res`, after the statements sunk right before it
+ */
+static void emit_sunk(
+    const std::vector<koopa::Stmt*>& stmts, const std::vector<std::vector<int>>& sunk_befores,
+    int i, std::vector<koopa::Stmt*>& res
+) {
+    for (int sunk: sunk_befores[i]) {
+        emit_sunk(stmts, sunk_befores, sunk, res);
+    }
+    res.push_back(stmts[i]);
+}
+
+void lower_addresses(const koopa::FuncDef* func_def) {
+    alloc_pseudo_ids.clear();
+    folded_ptr_ariths.clear();
+    current_folded_ids.clear();
+
+    auto blocks { func_def->get_blocks() };
+
+    auto use_counts { std::unordered_map<const koopa::Id*, int>() };
+    auto addr_use_counts { std::unordered_map<const koopa::Id*, int>() };
+    for (auto* block: blocks) {
+        for (auto* stmt: block->get_stmts()) {
+            for (auto* id: stmt->get_used_ids()) {
+                use_counts[id]++;
+            }
+            if (auto* addr { get_addr_use(stmt) }) {
+                addr_use_counts[addr]++;
+            }
+        }
+    }
+
+    for (auto* block: blocks) {
+        for (auto* stmt: block->get_stmts()) {
+            auto* symbol_def { dynamic_cast<koopa::SymbolDef*>(stmt) };
+            if (symbol_def == nullptr) continue;
+
+            auto* memory_decl { dynamic_cast<koopa::MemoryDecl*>(symbol_def->get_val()) };
+            if (memory_decl == nullptr) continue;
+
+            auto* id { symbol_def->get_def_id() };
+            alloc_pseudo_ids[id] = memory_decl->get_pseudo_id();
+            if (use_counts[id] == addr_use_counts[id]) {
+                current_folded_ids.insert(id);
+            }
+        }
+    }
+
+    for (auto* block: blocks) {
+        auto& stmts { block->get_stmts() };
+        int stmt_n { static_cast<int>(stmts.size()) };
+
+        auto addr_users { std::unordered_map<const koopa::Id*, int>() };
+        for (int i { 0 }; i < stmt_n; i++) {
+            if (auto* addr { get_addr_use(stmts[i]) }) {
+                addr_users[addr] = i;
+            }
+        }
+
+        auto sunk_befores { std::vector<std::vector<int>>(stmt_n) };
+        auto is_sunk { std::vector<bool>(stmt_n, false) };
+        for (int i { 0 }; i < stmt_n; i++) {
+            auto* symbol_def { dynamic_cast<koopa::SymbolDef*>(stmts[i]) };
+            if (symbol_def == nullptr) continue;
+
+            auto ptr_arith { get_ptr_arith(symbol_def->get_val()) };
+            auto* id { symbol_def->get_def_id() };
+            if (!ptr_arith || use_counts[id] != 1 || addr_use_counts[id] != 1) continue;
+
+            auto user { addr_users.find(id) };
+            if (user == addr_users.end() || user->second <= i) continue;
+
+            sunk_befores[user->second].push_back(i);
+            is_sunk[i] = true;
+            folded_ptr_ariths[id] = *ptr_arith;
+            current_folded_ids.insert(id);
+        }
+
+        auto res { std::vector<koopa::Stmt*>() };
+        res.reserve(stmt_n);
+        for (int i { 0 }; i < stmt_n; i++) {
+            if (!is_sunk[i]) {
+                emit_sunk(stmts, sunk_befores, i, res);
+            }
+        }
+        stmts = std::move(res);
+    }
+}
+
+Address get_address(koopa::Id* ptr) {
+    auto alloc { alloc_pseudo_ids.find(ptr) };
+    if (alloc != alloc_pseudo_ids.end()) {
+        return { alloc->second, true, {}, 0 };
+    }
+
+    auto folded { folded_ptr_ariths.find(ptr) };
+    if (folded != folded_ptr_ariths.end()) {
+        auto& ptr_arith { folded->second };
+        return get_address(ptr_arith.base, ptr_arith.index, ptr_arith.stride);
+    }
+
+    return { ptr, false, {}, 0 };
+}
+
+Address get_address(koopa::Id* base, koopa::Value* index, int stride) {
+    auto res { get_address(base) };
+
+    if (index->is_const()) {
+        res.offset += index->get_val() * stride;
+    }
+    else {
+        auto* index_id { dynamic_cast<koopa::Id*>(index) };
+        assert(index_id != nullptr);
+        res.scaled_indexes.push_back({ index_id, stride });
+    }
+
+    return res;
+}
+
+static bool is_same_reg(Register a, Register b) {
+    return a.get_serial_num() == b.get_serial_num();
+}
+
+/*
+ * `index * stride`, scaled in place if `index` is read into a scratch register
+ */
+static Register scaled_index_to_riscv(MachineBasicBlock& mbb, koopa::Id* index, int stride) {
+    auto index_reg { index->value_to_riscv(mbb) };
+    if (stride == 1) return index_reg;
+
+    bool is_in_place { temp_reg_manager.is_temp_reg(index_reg) };
+    int k { get_log2(stride) };
+
+    if (k != -1) {
+        auto target_reg { is_in_place ? index_reg : temp_reg_manager.get_unused_reg() };
+        mbb += MachineInstr(Opcode::Slli, { target_reg, index_reg, k });
+        return target_reg;
+    }
+
+    if (is_in_place) {
+        if (enable_zba && sh_add_mul_to_riscv(mbb, index_reg, index_reg, stride)) {
+            return index_reg;
+        }
+
+        // no register left for the shifts and adds of `mul_by_const_to_riscv`
+        auto stride_reg { temp_reg_manager.get_unused_reg() };
+        mbb += MachineInstr(Opcode::Li, { stride_reg, stride });
+        mbb += MachineInstr(Opcode::Mul, { index_reg, index_reg, stride_reg });
+        temp_reg_manager.refresh_reg(stride_reg);
+        return index_reg;
+    }
+
+    auto target_reg { temp_reg_manager.get_unused_reg() };
+    mul_by_const_to_riscv(mbb, target_reg, index_reg, stride);
+    return target_reg;
+}
+
+Register address_to_riscv(MachineBasicBlock& mbb, const Address& address, int& offset) {
+    offset = address.offset;
+
+    Register base_reg;
+    if (address.is_stack) {
+        auto* stack_frame { dynamic_cast<StackFrame*>(id_storage_map.get_storage(address.root)) };
+        assert(stack_frame != nullptr);
+
+        offset += stack_frame->get_offset();
+        base_reg = get_frame_base(offset);
+    }
+    else {
+        base_reg = id_storage_map.get_storage(address.root)->get(mbb);
+    }
+
+    for (auto [index, stride]: address.scaled_indexes) {
+        auto sh_add_opcode { enable_zba ? get_sh_add_opcode(stride) : Opcode::Add };
+        bool is_sh_add { sh_add_opcode != Opcode::Add };
+
+        // `shNadd` scales the index by itself
+        auto term_reg { is_sh_add ? index->value_to_riscv(mbb) : scaled_index_to_riscv(mbb, index, stride) };
+
+        auto sum_reg {
+            temp_reg_manager.is_temp_reg(base_reg) ? base_reg
+                : temp_reg_manager.is_temp_reg(term_reg) ? term_reg
+                : temp_reg_manager.get_unused_reg()
+        };
+        if (is_sh_add) {
+            mbb += MachineInstr(sh_add_opcode, { sum_reg, term_reg, base_reg });
+        }
+        else {
+            mbb += MachineInstr(Opcode::Add, { sum_reg, base_reg, term_reg });
+        }
+
+        if (!is_same_reg(sum_reg, base_reg)) temp_reg_manager.refresh_reg(base_reg);
+        if (!is_same_reg(sum_reg, term_reg)) temp_reg_manager.refresh_reg(term_reg);
+        base_reg = sum_reg;
+    }
+
+    return base_reg;
+}
+
+std::vector<int> get_stack_access_offsets(const koopa::FuncDef* func_def) {
+    auto res { std::vector<int>() };
+    auto add_access = [&](const Address& address) {
+        if (!address.is_stack) return;
+
+        auto* stack_frame { dynamic_cast<StackFrame*>(id_storage_map.get_storage(address.root)) };
+        assert(stack_frame != nullptr);
+        res.push_back(stack_frame->get_offset() + address.offset);
+    };
+
+    for (auto* block: func_def->get_blocks()) {
+        for (auto* stmt: block->get_stmts()) {
+            auto* symbol_def { dynamic_cast<koopa::SymbolDef*>(stmt) };
+            if (symbol_def == nullptr) {
+                if (auto* addr { get_addr_use(stmt) }) {
+                    add_access(get_address(addr));
+                }
+                continue;
+            }
+
+            auto* val { symbol_def->get_val() };
+            if (auto* load { dynamic_cast<koopa::Load*>(val) }) {
+                add_access(get_address(load->get_addr()));
+            }
+            else if (current_folded_ids.count(symbol_def->get_def_id())) {
+                // computed by its user
+            }
+            else if (auto ptr_arith { get_ptr_arith(val) }) {
+                add_access(get_address(ptr_arith->base, ptr_arith->index, ptr_arith->stride));
+            }
+            else if (auto* memory_decl { dynamic_cast<koopa::MemoryDecl*>(val) }) {
+                add_access({ memory_decl->get_pseudo_id(), true, {}, 0 });
+            }
+        }
+    }
+
+    return res;
+}
+
+}
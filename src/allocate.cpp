@@ -1,17 +1,29 @@
 #include "riscv_trans.h"
+#include "allocate.h"
+#include "address_lowering.h"
 #include "value_manager.h"
+#include "def.h"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
 
 static int max(int a, int b) { return a > b ? a : b; }
 
 /**
- * @return the maximum number of parameters of the functions being called 
+ * @return the maximum number of parameters of the functions being called, 
+ *         but in tail calls
  * @example  max_called_func_param_n( main() { f(1, 2); g(1, 2, 3, 4); } ) => 4
  */
 static unsigned get_max_called_func_param_n(const koopa::FuncDef* func_def) {
     unsigned result { 0 };
     for (auto* block: func_def->get_blocks()) {
         for (auto* stmt: block->get_stmts()) {
-            if (stmt->is_func_call()) {
+            if (stmt->is_func_call() && riscv_trans::current_tail_calls.count(stmt) == 0) {
                 result = max(result, stmt->get_func_call_param_n() );
             }
         }
@@ -20,12 +32,13 @@ static unsigned get_max_called_func_param_n(const koopa::FuncDef* func_def) {
 }
 
 /**
- * @return whether function is called in the body of func_def
+ * @return whether function is called in the body of func_def other than by
+ *         a tail call, which leaves ra as it is
  */
 static bool has_called_func(const koopa::FuncDef* func_def) {
     for (auto* block: func_def->get_blocks()) {
         for (auto* stmt: block->get_stmts()) {
-            if (stmt->is_func_call()) {
+            if (stmt->is_func_call() && riscv_trans::current_tail_calls.count(stmt) == 0) {
                 return true;
             }
         }
@@ -33,20 +46,142 @@ static bool has_called_func(const koopa::FuncDef* func_def) {
     return false;
 }
 
-static void allocate_location(const koopa::FuncDef* func_def, int stack_frame_size) {
-    if (riscv_trans::current_has_called_func) {
-        stack_frame_size -= 4; // reserve for ra
+/**
+ * @return callee-saved registers the allocator assigned to identifiers of
+ *         func_def, in order of register number
+ */
+static std::vector<riscv_trans::Register> get_saved_regs(const koopa::FuncDef* func_def) {
+    bool is_saved[riscv_trans::REG_COUNT] {};
+
+    for (auto* id: riscv_trans::get_value_ids(func_def)) {
+        if (!riscv_trans::id_storage_map.does_id_exist(id)) continue;
+
+        auto* reg { dynamic_cast<riscv_trans::Register*>(riscv_trans::id_storage_map.get_storage(id)) };
+        if (reg != nullptr && reg->is_callee_saved()) {
+            is_saved[reg->get_serial_num()] = true;
+        }
     }
 
-    auto func_ids { value_manager.get_func_ids(func_def->get_id()->get_lit()) };
-    for (auto* id : func_ids) {
-        stack_frame_size -= id->get_type()->get_byte_size();
+    auto result { std::vector<riscv_trans::Register>() };
+    for (int i { 0 }; i < riscv_trans::REG_COUNT; i++) {
+        if (is_saved[i]) {
+            result.push_back(riscv_trans::Register(i));
+        }
+    }
+    return result;
+}
+
+/**
+ * @return  bytes at the bottom of the stack frame for the arguments beyond
+ *          the eighth of the functions being called
+ */
+static int get_outgoing_arg_size(const koopa::FuncDef* func_def) {
+    unsigned max_called_func_param_n { get_max_called_func_param_n(func_def) };
+    return max_called_func_param_n > 8 ? 4 * (max_called_func_param_n - 8) : 0;
+}
+
+/*
+ * give each of `spilled_ids` a slot of the spill area, stored into
+ * `slot_offsets` as the offset from the bottom of the area. values whose live
+ * intervals do not overlap share a slot: the intervals are scanned in order
+ * of start, each taking a slot released by one ended before it if there is
+ * any, just as `linear_scan_allocate` hands out registers.
+ *
+ * @return  size of the spill area
+ */
+static int assign_spill_slots(
+    const koopa::FuncDef* func_def,
+    const std::vector<koopa::Id*>& spilled_ids,
+    std::unordered_map<const koopa::Id*, int>& slot_offsets
+) {
+    int area_size { 0 };
+    auto new_slot = [&](int byte_size) {
+        int res { area_size };
+        area_size += byte_size;
+        return res;
+    };
+
+    auto intervals { riscv_trans::build_live_intervals(func_def, spilled_ids) };
+
+    // `(end, offset)` of the intervals holding a slot, the earliest end on top
+    using Active = std::pair<int, int>;
+    std::priority_queue<Active, std::vector<Active>, std::greater<Active>> active;
+    // offsets of the released slots, by byte size
+    std::map<int, std::vector<int>> free_slots;
+    std::unordered_map<int, int> slot_sizes;
+
+    for (auto& interval: intervals) {
+        while (!active.empty() && active.top().first < interval.start) {
+            int offset { active.top().second };
+            free_slots[slot_sizes[offset]].push_back(offset);
+            active.pop();
+        }
+
+        int byte_size { static_cast<int>(interval.id->get_type()->get_byte_size()) };
+        auto& candidates { free_slots[byte_size] };
+
+        int offset;
+        if (candidates.empty()) {
+            offset = new_slot(byte_size);
+            slot_sizes[offset] = byte_size;
+        }
+        else {
+            offset = candidates.back();
+            candidates.pop_back();
+        }
+
+        active.push({ interval.end, offset });
+        slot_offsets[interval.id] = offset;
+    }
+
+    // never referred to, but given a place all the same
+    for (auto* id: spilled_ids) {
+        if (slot_offsets.count(id) == 0) {
+            slot_offsets[id] = new_slot(id->get_type()->get_byte_size());
+        }
+    }
+
+    return area_size;
+}
+
+/*
+ * the stack frame, from `sp` upwards:
+ *
+ *      arguments beyond the eighth of the functions being called
+ *      spill slots
+ *      memory declared by `alloc`, the smaller ones first
+ *      callee-saved registers
+ *      ra
+ *
+ * so that the scalars accessed most often stay within the IMM12 range of `sp`
+ * even when the function has large local arrays.
+ */
+static void allocate_location(
+    const koopa::FuncDef* func_def, 
+    const std::vector<koopa::Id*>& pseudo_ids, 
+    const std::unordered_map<const koopa::Id*, int>& slot_offsets,
+    int spill_area_size
+) {
+    int spill_area_offset { get_outgoing_arg_size(func_def) };
+    for (auto [id, offset]: slot_offsets) {
         riscv_trans::id_storage_map.register_id(
             id, 
-            new riscv_trans::StackFrame(stack_frame_size)
+            new riscv_trans::StackFrame(spill_area_offset + offset)
         );
     }
 
+    int offset { spill_area_offset + spill_area_size };
+    for (auto* id: pseudo_ids) {
+        riscv_trans::id_storage_map.register_id(id, new riscv_trans::StackFrame(offset));
+        offset += id->get_type()->get_byte_size();
+    }
+}
+
+/*
+ * the first eight parameters stay in a0-a7, the others are where the caller
+ * put them, right above the stack frame
+ */
+static void allocate_params(const koopa::FuncDef* func_def) {
     int param_count { 0 };
     for (auto* id: func_def->get_formal_param_ids()) {
         if (param_count < 8) {
@@ -67,11 +202,42 @@ static void allocate_location(const koopa::FuncDef* func_def, int stack_frame_si
     }
 }
 
-static int get_stack_frame_size(const koopa::FuncDef* func_def) {
-    int stack_frame_size { 0 };
+/*
+ * the anchor for `get_frame_base`, the start of the IMM12 range of `fp` put
+ * at the one of `accesses` past that of `sp` that makes it cover the most of
+ * them. 0 unless it covers `MIN_ANCHORED_ACCESS_N` of them
+ */
+static constexpr int MIN_ANCHORED_ACCESS_N = 2;
+
+static int get_anchor_offset(std::vector<int> accesses) {
+    accesses.erase(
+        std::remove_if(accesses.begin(), accesses.end(), riscv_trans::is_within_imm12_range),
+        accesses.end()
+    );
+    std::sort(accesses.begin(), accesses.end());
+
+    int best_n { 0 }, best_begin { 0 };
+    for (int begin { 0 }, end { 0 }; begin < accesses.size(); begin++) {
+        while (end < accesses.size() && accesses[end] - accesses[begin] <= riscv_trans::IMM12_MAX - riscv_trans::IMM12_MIN) {
+            end++;
+        }
+        if (end - begin > best_n) {
+            best_n = end - begin;
+            best_begin = begin;
+        }
+    }
+
+    return best_n >= MIN_ANCHORED_ACCESS_N ? accesses[best_begin] - riscv_trans::IMM12_MIN : 0;
+}
+
+static int get_stack_frame_size(
+    const koopa::FuncDef* func_def, 
+    const std::vector<koopa::Id*>& pseudo_ids,
+    int spill_area_size
+) {
+    int stack_frame_size { spill_area_size };
 
-    auto func_ids { value_manager.get_func_ids(func_def->get_id()->get_lit()) };
-    for (auto* id : func_ids) {
+    for (auto* id : pseudo_ids) {
         stack_frame_size += id->get_type()->get_byte_size();
     }
 
@@ -82,27 +248,153 @@ static int get_stack_frame_size(const koopa::FuncDef* func_def) {
         stack_frame_size += 4;
     }
 
-    unsigned max_called_func_param_n { get_max_called_func_param_n(func_def) };
+    /*
+     * to save callee-saved registers
+     */
+    stack_frame_size += 4 * riscv_trans::current_saved_regs.size();
+
     /*
      * to save callee's arguments
      */
-    if (max_called_func_param_n > 8) {
-        stack_frame_size += 4 * (max_called_func_param_n - 8);
-    }
+    stack_frame_size += get_outgoing_arg_size(func_def);
 
-    stack_frame_size = (stack_frame_size / 16 + 1) * 16; // align to 4bit
+    /*
+     * align to 16 bytes. a leaf function whose values all obtained caller-saved
+     * registers needs no frame at all, and then `sp` is left untouched
+     */
+    stack_frame_size = (stack_frame_size + 15) / 16 * 16;
 
     return stack_frame_size;
 }
 
+static const char* get_strategy_name(riscv_trans::RegAllocStrategy strategy) {
+    switch (strategy) {
+        case riscv_trans::RegAllocStrategy::Naive: return "naive";
+        case riscv_trans::RegAllocStrategy::LinearScan: return "linear-scan";
+        case riscv_trans::RegAllocStrategy::GraphColoring: return "graph-coloring";
+    }
+    return "";
+}
+
+/*
+ * the parameters arriving in a0-a7 stay there even with the naive strategy,
+ * so each is saved around the calls within its live interval
+ */
+static void save_reg_params_across_calls(const koopa::FuncDef* func_def) {
+    auto formal_param_ids { func_def->get_formal_param_ids() };
+    formal_param_ids.resize(std::min(static_cast<int>(formal_param_ids.size()), 8));
+
+    auto calls { riscv_trans::get_indexed_calls(func_def) };
+    for (auto& interval: riscv_trans::build_live_intervals(func_def, formal_param_ids)) {
+        if (!interval.crosses_call) continue;
+
+        for (auto [stmt_index, func_call]: calls) {
+            if (interval.start <= 2 * stmt_index && 2 * stmt_index + 1 <= interval.end) {
+                riscv_trans::current_call_saved_ids[func_call].push_back(interval.id);
+            }
+        }
+    }
+}
+
+/*
+ * print how many of the values (identifiers other than the memory declared
+ * by `alloc`) of `func_def` are left on the stack frame
+ * @example  `@fib: 2 of 19 values spilled (graph-coloring)`
+ */
+static void report_spill_count(
+    const koopa::FuncDef* func_def, 
+    const std::vector<koopa::Id*>& stack_ids
+) {
+    auto func_lit { func_def->get_id()->get_lit() };
+    int pseudo_id_n = riscv_trans::get_pseudo_ids(func_def).size();
+    int value_n = riscv_trans::get_value_ids(func_def).size() - riscv_trans::current_folded_ids.size();
+    int spilled_n = stack_ids.size() - pseudo_id_n;
+
+    std::cerr << func_lit << ": " << spilled_n << " of " << value_n << " values spilled ("
+        << get_strategy_name(riscv_trans::reg_alloc_strategy) << ")" << std::endl;
+}
+
 void riscv_trans::allocate_ids_storage_location(const koopa::FuncDef* func_def) {
+    current_has_called_func = has_called_func(func_def);
+    current_call_saved_ids.clear();
+    current_save_slots.clear();
+
+    auto stack_ids { std::vector<koopa::Id*>() };
+    switch (reg_alloc_strategy) {
+        case RegAllocStrategy::Naive:
+            /*
+             * naive strategy: allocate all identifiers to stack frame
+             */
+            stack_ids = get_pseudo_ids(func_def);
+            for (auto* id: get_value_ids(func_def)) {
+                if (current_folded_ids.count(id) == 0) {
+                    stack_ids.push_back(id);
+                }
+            }
+            save_reg_params_across_calls(func_def);
+            break;
+
+        case RegAllocStrategy::LinearScan:
+            stack_ids = linear_scan_allocate(func_def);
+            break;
+
+        case RegAllocStrategy::GraphColoring:
+            stack_ids = graph_coloring_allocate(func_def);
+            break;
+    }
+
+    if (debug_mode_regalloc) {
+        report_spill_count(func_def, stack_ids);
+    }
+
+    current_saved_regs = get_saved_regs(func_def);
+
+    auto pseudo_ids { riscv_trans::get_pseudo_ids(func_def) };
+    std::stable_sort(pseudo_ids.begin(), pseudo_ids.end(), [](koopa::Id* a, koopa::Id* b) {
+        return a->get_type()->get_byte_size() < b->get_type()->get_byte_size();
+    });
+
+    std::unordered_set<koopa::Id*> pseudo_id_set(pseudo_ids.begin(), pseudo_ids.end());
+    auto spilled_ids { std::vector<koopa::Id*>() };
+    for (auto* id: stack_ids) {
+        if (pseudo_id_set.count(id) == 0) {
+            spilled_ids.push_back(id);
+        }
+    }
+
     /*
-     * naive strategy: allocate all identifiers to stack frame
+     * values saved around calls need a slot to be saved into as well, which
+     * is theirs through their live interval just like that of a spilled one
      */
+    std::unordered_set<const koopa::Id*> saved_id_set;
+    for (auto& [func_call, ids]: current_call_saved_ids) {
+        saved_id_set.insert(ids.begin(), ids.end());
+    }
 
-    current_has_called_func = has_called_func(func_def);
+    auto slot_ids { spilled_ids };
+    for (auto* id: get_value_ids(func_def)) {
+        if (saved_id_set.count(id)) slot_ids.push_back(id);
+    }
+    for (auto* id: func_def->get_formal_param_ids()) {
+        if (saved_id_set.count(id)) slot_ids.push_back(id);
+    }
+
+    auto slot_offsets { std::unordered_map<const koopa::Id*, int>() };
+    int spill_area_size { assign_spill_slots(func_def, slot_ids, slot_offsets) };
+
+    for (auto* id: saved_id_set) {
+        current_save_slots[id] = get_outgoing_arg_size(func_def) + slot_offsets.at(id);
+        slot_offsets.erase(id);
+    }
+
+    allocate_location(func_def, pseudo_ids, slot_offsets, spill_area_size);
+
+    current_anchor_offset = enable_frame_anchor ? get_anchor_offset(get_stack_access_offsets(func_def)) : 0;
+    if (current_anchor_offset != 0) {
+        current_saved_regs.push_back(Register("fp"));
+    }
+
+    current_stack_frame_size = get_stack_frame_size(func_def, pseudo_ids, spill_area_size);
 
-    current_stack_frame_size = get_stack_frame_size(func_def);
-    
-    allocate_location(func_def, current_stack_frame_size);
+    allocate_params(func_def);
 }
\ No newline at end of file
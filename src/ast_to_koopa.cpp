@@ -781,7 +781,15 @@ koopa_trans::GlobalStmts* ConstGlobalVarDef::to_koopa() const {
         return stmts;
     }
     else /* get_type()->get_dim() > 0 */ { 
-        return VolatileGlobalVarDef(type, id, init).to_koopa();
+        auto* stmts { VolatileGlobalVarDef(type, id, init).to_koopa() };
+
+        for (auto* stmt: stmts->to_raw_vector()) {
+            if (auto* global_symbol_def { dynamic_cast<koopa::GlobalSymbolDef*>(stmt) }) {
+                global_symbol_def->get_decl()->set_read_only();
+            }
+        }
+
+        return stmts;
     }
 }
 
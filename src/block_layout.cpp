@@ -0,0 +1,269 @@
+#include "block_layout.h"
+#include "cfg.h"
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace riscv_trans {
+
+bool enable_block_layout { true };
+
+/**
+ * @return  index of the last instruction of `instrs` other than a comment,
+ *          -1 if there is none
+ */
+static int get_last_instr(const std::vector<MachineInstr>& instrs, int end) {
+    int i { end - 1 };
+    while (i >= 0 && instrs[i].get_opcode() == Opcode::Comment) i--;
+    return i;
+}
+
+/**
+ * @return  index of the conditional branch right before the `j` at `jump`,
+ *          -1 if there is none
+ */
+static int get_cond_branch(const std::vector<MachineInstr>& instrs, int jump) {
+    int i { get_last_instr(instrs, jump) };
+    return i >= 0 && is_cond_branch(instrs[i].get_opcode()) ? i : -1;
+}
+
+static const std::string& get_target(const MachineInstr& instr) {
+    return instr.get_operand(instr.get_operand_n() - 1).get_symbol();
+}
+
+/**
+ * @return  whether control never falls through `opcode` to the next block
+ */
+static bool is_terminator(Opcode opcode) {
+    return opcode == Opcode::J || opcode == Opcode::Tail || opcode == Opcode::Ret;
+}
+
+/*
+ * end every block falling through to the next one with a `j` to it, so that
+ * the blocks may be moved freely
+ */
+static void add_explicit_jumps(std::vector<MachineBasicBlock>& blocks) {
+    for (int i { 0 }; i + 1 < blocks.size(); i++) {
+        auto& instrs { blocks[i].get_instrs() };
+        int last { get_last_instr(instrs, instrs.size()) };
+
+        if (last == -1 || !is_terminator(instrs[last].get_opcode())) {
+            blocks[i] += MachineInstr(Opcode::J, { blocks[i + 1].get_label() });
+        }
+    }
+}
+
+/*
+ * grows a chain of blocks from the entry, each time following the successor
+ * most likely taken, which is the one staying in the loop, or the one laid
+ * out first originally, the loops being the natural ones of `dataflow::Cfg`. A loop is finished before any block out of it is
+ * placed, and a loop whose header tests for the exit is rotated, entering at
+ * the body so that the latch falls through into the header and the header
+ * into the exit.
+ */
+class BlockPlacer {
+public:
+    BlockPlacer(const dataflow::Cfg& cfg): cfg(cfg), loops(cfg.get_loops()),
+        contains(loops.size(), std::vector<bool>(cfg.get_block_n(), false)),
+        is_placed(cfg.get_block_n(), false), unplaced_ns(loops.size()) {
+        for (int l { 0 }; l < loops.size(); l++) {
+            for (int block: loops[l].blocks) contains[l][block] = true;
+            unplaced_ns[l] = loops[l].blocks.size();
+        }
+    }
+
+    std::vector<int> place() {
+        int block { 0 };
+        while (block != -1) {
+            place_block(block);
+
+            block = choose_succ(block);
+            if (block == -1) {
+                block = choose_seed(block_of_last());
+            }
+        }
+        return order;
+    }
+
+private:
+    const dataflow::Cfg& cfg;
+    const std::vector<dataflow::Loop>& loops;
+    std::vector<std::vector<bool>> contains;
+
+    std::vector<bool> is_placed;
+    std::vector<int> unplaced_ns;
+    std::vector<int> order;
+
+    int block_of_last() const { return order.back(); }
+
+    void place_block(int block) {
+        is_placed[block] = true;
+        order.push_back(block);
+        for (int l { 0 }; l < loops.size(); l++) {
+            if (contains[l][block]) unplaced_ns[l]--;
+        }
+    }
+
+    bool is_in(int loop, int block) const {
+        return loop == -1 || contains[loop][block];
+    }
+
+    /*
+     * innermost loop around `block` which still has blocks to place
+     */
+    int get_open_loop(int block) const {
+        int loop { cfg.get_loop(block) };
+        while (loop != -1 && unplaced_ns[loop] == 0) {
+            loop = loops[loop].parent;
+        }
+        return loop;
+    }
+
+    int choose_succ(int block) {
+        int loop { get_open_loop(block) };
+
+        int best { -1 };
+        for (int succ: cfg.get_succs(block)) {
+            if (is_placed[succ] || !is_in(loop, succ)) continue;
+
+            int depth { cfg.get_loop_depth(succ) }, best_depth { best == -1 ? -1 : cfg.get_loop_depth(best) };
+            if (depth > best_depth || (depth == best_depth && succ < best)) {
+                best = succ;
+            }
+        }
+
+        if (best == -1) return -1;
+        return rotate(block, best);
+    }
+
+    /**
+     * @return  the only successor of `header` in its loop, if the chain enters
+     *          the loop at `header` from `from` and `header` may leave the loop,
+     *          `header` otherwise
+     */
+    int rotate(int from, int header) const {
+        // the innermost loop of a header is the one it heads
+        int loop { cfg.get_loop(header) };
+        if (loop == -1 || loops[loop].header != header || contains[loop][from]) return header;
+
+        int body { -1 };
+        bool has_exit { false };
+        for (int succ: cfg.get_succs(header)) {
+            if (!contains[loop][succ]) {
+                has_exit = true;
+            }
+            else if (succ != header && !is_placed[succ]) {
+                if (body != -1) return header;
+                body = succ;
+            }
+        }
+
+        return has_exit && body != -1 ? body : header;
+    }
+
+    /*
+     * the first block left in the innermost open loop, preferring those a
+     * placed block jumps to
+     */
+    int choose_seed(int block) const {
+        for (int loop { get_open_loop(block) }; ; loop = loops[loop].parent) {
+            int first { -1 };
+            for (int candidate { 0 }; candidate < cfg.get_block_n(); candidate++) {
+                if (is_placed[candidate] || !is_in(loop, candidate)) continue;
+
+                for (int pred: cfg.get_preds(candidate)) {
+                    if (is_placed[pred]) return candidate;
+                }
+                if (first == -1) first = candidate;
+            }
+
+            if (first != -1) return first;
+            if (loop == -1) return -1;
+        }
+    }
+};
+
+/*
+ * make each block jump to its successors in the new order, inverting the
+ * branch if the block it branches to is the next one
+ */
+static void fix_terminators(std::vector<MachineBasicBlock>& blocks) {
+    for (int i { 0 }; i < blocks.size(); i++) {
+        auto& instrs { blocks[i].get_instrs() };
+        int jump { get_last_instr(instrs, instrs.size()) };
+        if (jump == -1 || instrs[jump].get_opcode() != Opcode::J) continue;
+
+        auto next { i + 1 < blocks.size() ? blocks[i + 1].get_label() : std::string() };
+        int branch { get_cond_branch(instrs, jump) };
+
+        if (get_target(instrs[jump]) == next) {
+            instrs.erase(instrs.begin() + jump);
+        }
+        else if (branch != -1 && get_target(instrs[branch]) == next) {
+            auto& instr { instrs[branch] };
+            instr.set_opcode(get_inverse_branch(instr.get_opcode()));
+            instr.get_operand(instr.get_operand_n() - 1) = get_target(instrs[jump]);
+            instrs.erase(instrs.begin() + jump);
+        }
+    }
+}
+
+void layout_blocks(MachineFunction& func) {
+    auto& blocks { func.get_blocks() };
+
+    add_explicit_jumps(blocks);
+
+    auto index_of_label { std::unordered_map<std::string, int>() };
+    for (int i { 0 }; i < blocks.size(); i++) {
+        index_of_label[blocks[i].get_label()] = i;
+    }
+
+    /*
+     * the edges are those of the machine blocks rather than of the koopa
+     * ones: a tail call to the function itself jumps back to the entry, a
+     * zeroed array loops, edges passing arguments get blocks of their own and
+     * blocks bypassed by a `max` or `min` are gone. Their loops are found as
+     * those of the koopa blocks, no koopa block being behind any of them.
+     */
+    dataflow::FlowGraph graph;
+    graph.blocks.assign(blocks.size(), nullptr);
+    graph.succs.resize(blocks.size());
+    graph.preds.resize(blocks.size());
+    auto& succs { graph.succs };
+    for (int i { 0 }; i < blocks.size(); i++) {
+        auto& instrs { blocks[i].get_instrs() };
+        int jump { get_last_instr(instrs, instrs.size()) };
+        if (jump == -1 || instrs[jump].get_opcode() != Opcode::J) continue;
+
+        int branch { get_cond_branch(instrs, jump) };
+        if (branch != -1) {
+            succs[i].push_back(index_of_label.at(get_target(instrs[branch])));
+        }
+
+        int target { index_of_label.at(get_target(instrs[jump])) };
+        if (succs[i].empty() || succs[i][0] != target) {
+            succs[i].push_back(target);
+        }
+    }
+    for (int i { 0 }; i < blocks.size(); i++) {
+        for (int succ: succs[i]) {
+            graph.preds[succ].push_back(i);
+        }
+    }
+
+    dataflow::Cfg cfg(std::move(graph));
+    auto order { BlockPlacer(cfg).place() };
+
+    auto placed_blocks { std::vector<MachineBasicBlock>() };
+    placed_blocks.reserve(blocks.size());
+    for (int i: order) {
+        placed_blocks.push_back(std::move(blocks[i]));
+    }
+    blocks = std::move(placed_blocks);
+
+    fix_terminators(blocks);
+}
+
+}
@@ -0,0 +1,209 @@
+#include "cfg.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+namespace dataflow {
+
+Cfg::Cfg(const koopa::FuncDef* func_def): Cfg(build_flow_graph(func_def)) {}
+
+Cfg::Cfg(FlowGraph flow_graph): graph(std::move(flow_graph)) {
+    indexes.reserve(graph.blocks.size());
+    for (int i { 0 }; i < graph.blocks.size(); i++) {
+        if (graph.blocks[i] != nullptr) indexes.emplace(graph.blocks[i], i);
+    }
+
+    build_dom_tree();
+    build_loops();
+}
+
+const FlowGraph& Cfg::get_graph() const { return graph; }
+int Cfg::get_block_n() const { return graph.blocks.size(); }
+koopa::Block* Cfg::get_block(int block) const { return graph.blocks[block]; }
+
+int Cfg::get_index(const koopa::Block* block) const {
+    auto res { indexes.find(block) };
+    return res == indexes.end() ? -1 : res->second;
+}
+
+const std::vector<int>& Cfg::get_succs(int block) const { return graph.succs[block]; }
+const std::vector<int>& Cfg::get_preds(int block) const { return graph.preds[block]; }
+
+const std::vector<int>& Cfg::get_reverse_postorder() const { return order; }
+bool Cfg::is_reachable(int block) const { return block == 0 || idoms[block] != -1; }
+
+int Cfg::get_idom(int block) const { return idoms[block]; }
+const std::vector<int>& Cfg::get_dom_children(int block) const { return dom_children[block]; }
+
+bool Cfg::dominates(int a, int b) const {
+    if (!is_reachable(a) || !is_reachable(b)) return false;
+    return dom_preorders[a] <= dom_preorders[b] && dom_postorders[b] <= dom_postorders[a];
+}
+
+const std::vector<Loop>& Cfg::get_loops() const { return loops; }
+int Cfg::get_loop(int block) const { return block_loops[block]; }
+
+int Cfg::get_loop_depth(int block) const {
+    return block_loops[block] == -1 ? 0 : loops[block_loops[block]].depth;
+}
+
+void Cfg::build_dom_tree() {
+    int block_n { get_block_n() };
+    idoms.assign(block_n, -1);
+    dom_children.assign(block_n, {});
+    dom_preorders.assign(block_n, -1);
+    dom_postorders.assign(block_n, -1);
+    if (block_n == 0) return;
+
+    // the unreachable blocks come last and never obtain a dominator
+    auto full_order { dataflow::get_reverse_postorder(graph) };
+
+    std::vector<int> rpo_numbers(block_n);
+    for (int i { 0 }; i < block_n; i++) {
+        rpo_numbers[full_order[i]] = i;
+    }
+
+    idoms[0] = 0;
+
+    auto intersect = [&](int a, int b) {
+        while (a != b) {
+            while (rpo_numbers[a] > rpo_numbers[b]) a = idoms[a];
+            while (rpo_numbers[b] > rpo_numbers[a]) b = idoms[b];
+        }
+        return a;
+    };
+
+    for (bool is_changed { true }; is_changed; ) {
+        is_changed = false;
+
+        for (int i { 1 }; i < block_n; i++) {
+            int block { full_order[i] };
+
+            int idom { -1 };
+            for (int pred: graph.preds[block]) {
+                if (idoms[pred] == -1) continue;
+                idom = idom == -1 ? pred : intersect(pred, idom);
+            }
+
+            if (idom != idoms[block]) {
+                idoms[block] = idom;
+                is_changed = true;
+            }
+        }
+    }
+
+    idoms[0] = -1;
+
+    for (int block: full_order) {
+        if (is_reachable(block)) order.push_back(block);
+    }
+
+    for (int block: order) {
+        if (idoms[block] != -1) dom_children[idoms[block]].push_back(block);
+    }
+
+    // iterative dfs over the tree, each frame holding a block and its next child
+    int preorder { 0 }, postorder { 0 };
+    std::vector<std::pair<int, int>> frames { { 0, 0 } };
+    dom_preorders[0] = preorder++;
+    while (!frames.empty()) {
+        auto& [block, next] = frames.back();
+        if (next < dom_children[block].size()) {
+            int child { dom_children[block][next++] };
+            dom_preorders[child] = preorder++;
+            frames.push_back({ child, 0 });
+        }
+        else {
+            dom_postorders[block] = postorder++;
+            frames.pop_back();
+        }
+    }
+}
+
+void Cfg::build_loops() {
+    int block_n { get_block_n() };
+    block_loops.assign(block_n, -1);
+
+    /*
+     * an outer header dominates an inner one and so comes first in reverse
+     * postorder, and the innermost loop of each block is the last one found
+     * containing it
+     */
+    std::vector<int> worklist;
+    for (int header: order) {
+        for (int pred: graph.preds[header]) {
+            if (dominates(header, pred)) worklist.push_back(pred);
+        }
+        if (worklist.empty()) continue;
+
+        int index { static_cast<int>(loops.size()) };
+        int parent { block_loops[header] };
+        Loop loop { header, parent, parent == -1 ? 1 : loops[parent].depth + 1, { header } };
+
+        block_loops[header] = index;
+        while (!worklist.empty()) {
+            int block { worklist.back() };
+            worklist.pop_back();
+            if (block_loops[block] == index) continue;
+
+            block_loops[block] = index;
+            loop.blocks.push_back(block);
+            for (int pred: graph.preds[block]) {
+                if (is_reachable(pred)) worklist.push_back(pred);
+            }
+        }
+
+        std::sort(loop.blocks.begin() + 1, loop.blocks.end());
+        loops.push_back(std::move(loop));
+    }
+}
+
+std::vector<std::vector<int>> get_dominance_frontiers(const Cfg& cfg) {
+    std::vector<std::vector<int>> res(cfg.get_block_n());
+
+    for (int block: cfg.get_reverse_postorder()) {
+        if (cfg.get_preds(block).size() < 2) continue;
+
+        for (int pred: cfg.get_preds(block)) {
+            if (!cfg.is_reachable(pred)) continue;
+
+            for (int runner { pred }; runner != cfg.get_idom(block); runner = cfg.get_idom(runner)) {
+                if (res[runner].empty() || res[runner].back() != block) {
+                    res[runner].push_back(block);
+                }
+            }
+        }
+    }
+
+    return res;
+}
+
+static std::unordered_map<const koopa::FuncDef*, std::unique_ptr<Cfg>> cfgs;
+
+const Cfg& get_cfg(const koopa::FuncDef* func_def) {
+    auto& res { cfgs[func_def] };
+    if (res == nullptr) {
+        res = std::make_unique<Cfg>(func_def);
+    }
+    return *res;
+}
+
+void invalidate_cfg(const koopa::FuncDef* func_def) {
+    cfgs.erase(func_def);
+}
+
+bool remove_unreachable_blocks(koopa::FuncDef* func_def) {
+    auto& cfg { get_cfg(func_def) };
+    if (cfg.get_reverse_postorder().size() == cfg.get_block_n()) return false;
+
+    auto blocks { std::vector<koopa::Block*>() };
+    for (int i { 0 }; i < cfg.get_block_n(); i++) {
+        if (cfg.is_reachable(i)) blocks.push_back(cfg.get_block(i));
+    }
+    func_def->set_blocks(blocks);
+    invalidate_cfg(func_def);
+    return true;
+}
+
+}
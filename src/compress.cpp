@@ -0,0 +1,199 @@
+#include "compress.h"
+#include "def.h"
+
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace riscv_trans {
+
+/*
+ * reach of `c.beqz`, `c.bnez` and `c.j` from the branch itself
+ */
+static constexpr int CB_OFFSET_MIN = -256, CB_OFFSET_MAX = 254;
+static constexpr int CJ_OFFSET_MIN = -2048, CJ_OFFSET_MAX = 2046;
+
+int get_byte_size(const MachineInstr& instr) {
+    if (instr.is_compressed()) return 2;
+
+    switch (instr.get_opcode()) {
+        case Opcode::Comment:
+            return 0;
+        case Opcode::Li: {
+            int imm { instr.get_operand(1).get_imm() };
+            return is_within_imm12_range(imm) || (imm & 0xfff) == 0 ? 4 : 8;
+        }
+        case Opcode::La: case Opcode::Call: case Opcode::Tail:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+static bool is_same_reg(Register a, Register b) {
+    return a.get_serial_num() == b.get_serial_num();
+}
+
+static bool is_zero(Register reg) { return is_same_reg(reg, Register("zero")); }
+static bool is_sp(Register reg) { return is_same_reg(reg, Register("sp")); }
+
+static bool is_in_range(int x, int min, int max) { return x >= min && x <= max; }
+
+/**
+ * @return   whether `instr` has a compressed form, branches and jumps aside.
+ *           `add`, `and`, `or` and `xor` have their sources swapped if only
+ *           the other order fits
+ */
+static bool is_compressible(MachineInstr& instr) {
+    auto reg = [&](int i) { return instr.get_operand(i).get_reg(); };
+    auto imm = [&](int i) { return instr.get_operand(i).get_imm(); };
+
+    auto swap_sources_if = [&](bool cond) {
+        if (cond) std::swap(instr.get_operand(1), instr.get_operand(2));
+    };
+
+    switch (instr.get_opcode()) {
+        case Opcode::Li:
+            return !is_zero(reg(0)) && is_in_range(imm(1), -32, 31);
+
+        case Opcode::Mv:
+            return !is_zero(reg(0)) && !is_zero(reg(1));
+
+        case Opcode::Addi:
+            if (is_sp(reg(0)) && is_sp(reg(1))) {
+                return imm(2) != 0 && imm(2) % 16 == 0 && is_in_range(imm(2), -512, 496);
+            }
+            if (is_sp(reg(1))) {
+                return reg(0).is_compressible() && imm(2) > 0 && imm(2) % 4 == 0 && imm(2) <= 1020;
+            }
+            return is_same_reg(reg(0), reg(1)) && !is_zero(reg(0)) && imm(2) != 0 && is_in_range(imm(2), -32, 31);
+
+        case Opcode::Add:
+            swap_sources_if(!is_same_reg(reg(0), reg(1)) && is_same_reg(reg(0), reg(2)));
+            return is_same_reg(reg(0), reg(1)) && !is_zero(reg(0)) && !is_zero(reg(2));
+
+        case Opcode::And: case Opcode::Or: case Opcode::Xor:
+            swap_sources_if(!is_same_reg(reg(0), reg(1)) && is_same_reg(reg(0), reg(2)));
+            // fall through
+        case Opcode::Sub:
+            return is_same_reg(reg(0), reg(1)) && reg(0).is_compressible() && reg(2).is_compressible();
+
+        case Opcode::Andi:
+            return is_same_reg(reg(0), reg(1)) && reg(0).is_compressible() && is_in_range(imm(2), -32, 31);
+
+        case Opcode::Srli: case Opcode::Srai:
+            return is_same_reg(reg(0), reg(1)) && reg(0).is_compressible() && imm(2) > 0;
+
+        case Opcode::Slli:
+            return is_same_reg(reg(0), reg(1)) && !is_zero(reg(0)) && imm(2) > 0;
+
+        case Opcode::Lw: case Opcode::Sw: {
+            auto& mem { instr.get_operand(1) };
+            if (mem.get_imm() < 0 || mem.get_imm() % 4 != 0) return false;
+
+            if (is_sp(mem.get_reg())) {
+                return mem.get_imm() <= 252 && (instr.get_opcode() == Opcode::Sw || !is_zero(reg(0)));
+            }
+            return mem.get_imm() <= 124 && reg(0).is_compressible() && mem.get_reg().is_compressible();
+        }
+
+        case Opcode::Ret:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/**
+ * @return   whether `instr` is a branch or jump with a compressed form if
+ *           its target is near enough, the reach of that form set into
+ *           `min` and `max`
+ */
+static bool is_short_jump(const MachineInstr& instr, int& min, int& max) {
+    switch (instr.get_opcode()) {
+        case Opcode::Beqz: case Opcode::Bnez:
+            min = CB_OFFSET_MIN;
+            max = CB_OFFSET_MAX;
+            return instr.get_operand(0).get_reg().is_compressible();
+        case Opcode::J:
+            min = CJ_OFFSET_MIN;
+            max = CJ_OFFSET_MAX;
+            return true;
+        default:
+            return false;
+    }
+}
+
+static int get_func_byte_size(const MachineFunction& func) {
+    int res { 0 };
+    for (auto& block: func.get_blocks()) {
+        for (auto& instr: block.get_instrs()) {
+            res += get_byte_size(instr);
+        }
+    }
+    return res;
+}
+
+void compress_function(MachineFunction& func) {
+    int old_size { get_func_byte_size(func) };
+
+    for (auto& block: func.get_blocks()) {
+        for (auto& instr: block.get_instrs()) {
+            if (is_compressible(instr)) {
+                instr.set_compressed(true);
+            }
+        }
+    }
+
+    for (bool is_changed { true }; is_changed; ) {
+        is_changed = false;
+
+        auto label_addrs { std::unordered_map<std::string, int>() };
+        int addr { 0 };
+        for (auto& block: func.get_blocks()) {
+            label_addrs[block.get_label()] = addr;
+            for (auto& instr: block.get_instrs()) {
+                addr += get_byte_size(instr);
+            }
+        }
+
+        // decided on this layout as a whole, each only bringing the others
+        // nearer to their targets
+        auto reachings { std::vector<MachineInstr*>() };
+        addr = 0;
+        for (auto& block: func.get_blocks()) {
+            for (auto& instr: block.get_instrs()) {
+                int min, max;
+                if (!instr.is_compressed() && is_short_jump(instr, min, max)) {
+                    auto& target { instr.get_operand(instr.get_operand_n() - 1).get_symbol() };
+                    auto target_addr { label_addrs.find(target) };
+
+                    if (target_addr != label_addrs.end() && is_in_range(target_addr->second - addr, min, max)) {
+                        reachings.push_back(&instr);
+                    }
+                }
+                addr += get_byte_size(instr);
+            }
+        }
+
+        for (auto* instr: reachings) {
+            instr->set_compressed(true);
+            is_changed = true;
+        }
+    }
+
+    if (debug_mode_rvc) {
+        int new_size { get_func_byte_size(func) };
+        char saved_rate[16];
+        snprintf(saved_rate, sizeof(saved_rate), "%.1f", old_size ? 100.0 * (old_size - new_size) / old_size : 0.0);
+
+        std::cerr << func.get_name() << ": " << old_size << " -> " << new_size
+            << " bytes (-" << saved_rate << "%)" << std::endl;
+    }
+}
+
+}
@@ -0,0 +1,199 @@
+#include "dataflow.h"
+
+#include <algorithm>
+#include <deque>
+#include <string>
+
+namespace dataflow {
+
+BitSet::BitSet(int bit_n): bit_n(bit_n), words((bit_n + 63) / 64, 0) {}
+
+int BitSet::size() const { return bit_n; }
+
+void BitSet::set(int i) { words[i / 64] |= uint64_t(1) << (i % 64); }
+void BitSet::reset(int i) { words[i / 64] &= ~(uint64_t(1) << (i % 64)); }
+bool BitSet::test(int i) const { return (words[i / 64] >> (i % 64)) & 1; }
+
+void BitSet::set_all() {
+    for (auto& word: words) {
+        word = ~uint64_t(0);
+    }
+    if (bit_n % 64 != 0) {
+        words.back() = (uint64_t(1) << (bit_n % 64)) - 1;
+    }
+}
+
+bool BitSet::union_with(const BitSet& other) {
+    uint64_t changed { 0 };
+    for (int w { 0 }; w < words.size(); w++) {
+        auto word { words[w] | other.words[w] };
+        changed |= word ^ words[w];
+        words[w] = word;
+    }
+    return changed != 0;
+}
+
+bool BitSet::intersect_with(const BitSet& other) {
+    uint64_t changed { 0 };
+    for (int w { 0 }; w < words.size(); w++) {
+        auto word { words[w] & other.words[w] };
+        changed |= word ^ words[w];
+        words[w] = word;
+    }
+    return changed != 0;
+}
+
+void BitSet::subtract(const BitSet& other) {
+    for (int w { 0 }; w < words.size(); w++) {
+        words[w] &= ~other.words[w];
+    }
+}
+
+bool BitSet::operator==(const BitSet& other) const { return words == other.words; }
+bool BitSet::operator!=(const BitSet& other) const { return words != other.words; }
+
+
+ValueNumbering::ValueNumbering(const std::vector<koopa::Id*>& ids): ids(ids) {
+    numbers.reserve(ids.size());
+    for (int i { 0 }; i < ids.size(); i++) {
+        numbers.emplace(ids[i], i);
+    }
+}
+
+int ValueNumbering::size() const { return ids.size(); }
+
+int ValueNumbering::get_number(const koopa::Id* id) const {
+    auto res { numbers.find(id) };
+    return res == numbers.end() ? -1 : res->second;
+}
+
+koopa::Id* ValueNumbering::get_id(int number) const { return ids[number]; }
+
+
+FlowGraph build_flow_graph(const koopa::FuncDef* func_def) {
+    FlowGraph res;
+    res.blocks = func_def->get_blocks();
+
+    int block_n { static_cast<int>(res.blocks.size()) };
+    res.succs.resize(block_n);
+    res.preds.resize(block_n);
+
+    std::unordered_map<std::string, int> block_indexes;
+    for (int i { 0 }; i < block_n; i++) {
+        block_indexes.emplace(res.blocks[i]->get_label().get_name(), i);
+    }
+
+    for (int i { 0 }; i < block_n; i++) {
+        for (auto* stmt: res.blocks[i]->get_stmts()) {
+            for (auto& label: stmt->get_target_labels()) {
+                int succ { block_indexes.at(label.get_name()) };
+                res.succs[i].push_back(succ);
+                res.preds[succ].push_back(i);
+            }
+        }
+    }
+
+    return res;
+}
+
+std::vector<int> get_reverse_postorder(const FlowGraph& graph) {
+    int block_n { static_cast<int>(graph.blocks.size()) };
+
+    std::vector<int> postorder;
+    std::vector<bool> is_visited(block_n, false);
+
+    // iterative dfs, each frame holding a block and its next successor
+    std::vector<std::pair<int, int>> frames;
+    if (block_n > 0) {
+        frames.push_back({ 0, 0 });
+        is_visited[0] = true;
+    }
+    while (!frames.empty()) {
+        auto& [block, next] = frames.back();
+        if (next < graph.succs[block].size()) {
+            int succ { graph.succs[block][next++] };
+            if (!is_visited[succ]) {
+                is_visited[succ] = true;
+                frames.push_back({ succ, 0 });
+            }
+        }
+        else {
+            postorder.push_back(block);
+            frames.pop_back();
+        }
+    }
+
+    std::vector<int> res(postorder.rbegin(), postorder.rend());
+    for (int i { 0 }; i < block_n; i++) {
+        if (!is_visited[i]) res.push_back(i);
+    }
+    return res;
+}
+
+Solution solve(const FlowGraph& graph, const Problem& problem) {
+    int block_n { static_cast<int>(graph.blocks.size()) };
+    int bit_n { problem.boundary.size() };
+    bool is_forward { problem.direction == Direction::Forward };
+
+    /*
+     * `src` is the side of a block the meet flows into, `dst` the side the
+     * transfer function produces
+     */
+    Solution res { std::vector<BitSet>(block_n, BitSet(bit_n)), std::vector<BitSet>(block_n, BitSet(bit_n)) };
+    auto& srcs { is_forward ? res.in : res.out };
+    auto& dsts { is_forward ? res.out : res.in };
+    auto& flow_froms { is_forward ? graph.preds : graph.succs };
+    auto& flow_tos { is_forward ? graph.succs : graph.preds };
+
+    if (problem.meet == Meet::Intersection) {
+        for (auto& dst: dsts) {
+            dst.set_all();
+        }
+    }
+
+    auto order { get_reverse_postorder(graph) };
+    if (!is_forward) {
+        std::reverse(order.begin(), order.end());
+    }
+
+    std::deque<int> worklist(order.begin(), order.end());
+    std::vector<bool> is_in_worklist(block_n, true);
+
+    while (!worklist.empty()) {
+        int block { worklist.front() };
+        worklist.pop_front();
+        is_in_worklist[block] = false;
+
+        auto& src { srcs[block] };
+        bool is_boundary { is_forward ? block == 0 : flow_froms[block].empty() };
+        if (is_boundary) {
+            src = problem.boundary;
+        }
+        else {
+            src = BitSet(bit_n);
+            if (problem.meet == Meet::Intersection) src.set_all();
+        }
+        for (int from: flow_froms[block]) {
+            if (problem.meet == Meet::Union) src.union_with(dsts[from]);
+            else src.intersect_with(dsts[from]);
+        }
+
+        auto dst { src };
+        dst.subtract(problem.kills[block]);
+        dst.union_with(problem.gens[block]);
+
+        if (dst != dsts[block]) {
+            dsts[block] = std::move(dst);
+            for (int to: flow_tos[block]) {
+                if (!is_in_worklist[to]) {
+                    is_in_worklist[to] = true;
+                    worklist.push_back(to);
+                }
+            }
+        }
+    }
+
+    return res;
+}
+
+}
@@ -3,4 +3,8 @@ int tmp_var_count { 0 };
 
 bool debug_mode_koopa_type { false };
 bool debug_mode_koopa_pred_succ { false };
-bool debug_mode_riscv { false };
\ No newline at end of file
+bool debug_mode_riscv { false };
+bool debug_mode_regalloc { false };
+bool debug_mode_peephole { false };
+bool debug_mode_rvc { false };
+bool debug_mode_time_passes { false };
\ No newline at end of file
@@ -0,0 +1,453 @@
+#include "allocate.h"
+#include "cfg.h"
+#include "riscv_trans.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace riscv_trans {
+
+/*
+ * Chaitin-Briggs graph coloring allocator.
+ *
+ * the registers handed out are precolored nodes of the interference graph,
+ * so calling convention constraints are plain edges: values live while the
+ * arguments are set up interfere with the argument registers they are not
+ * passed in. values live across a call are colored with s1-s11, which come
+ * last so that they are only picked, and saved by the function, when the
+ * others are taken. When those run out too, such a value takes a
+ * caller-saved register the call saves and restores around itself instead,
+ * if that costs less than spilling it. koopa has no copy instruction, the moves coalesced are the
+ * ones implied by the calling convention, i.e. arguments into a0-a7 and
+ * results out of a0, which `Register::get` and `Register::save` then omit.
+ */
+
+static const char* allocatable_regs[] {
+    "t3", "t4", "t5", "t6", "a7", "a6", "a5", "a4", "a3", "a2", "a1", "a0",
+    "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11"
+};
+static constexpr int COLOR_N { sizeof(allocatable_regs) / sizeof(allocatable_regs[0]) };
+/*
+ * colors `0` to `CALLER_SAVED_N - 1` are clobbered by calls
+ */
+static constexpr int CALLER_SAVED_N { 12 };
+
+/*
+ * spill costs weigh each use and definition by `LOOP_WEIGHT ^ loop_depth`
+ */
+static constexpr double LOOP_WEIGHT { 10 };
+static constexpr int MAX_LOOP_DEPTH { 8 };
+
+/*
+ * colors in the order they are tried, with RVC the caller-saved ones among
+ * x8-x15, i.e. a0-a5, ahead of t3-t6 and a6-a7, as they have the most
+ * compressed forms
+ */
+static std::vector<int> get_color_order() {
+    auto res { std::vector<int>() };
+    for (int i { 0 }; i < COLOR_N; i++) {
+        res.push_back(i);
+    }
+    if (enable_rvc) {
+        std::stable_partition(res.begin(), res.begin() + CALLER_SAVED_N, [](int color) {
+            return Register(allocatable_regs[color]).is_compressible();
+        });
+    }
+    return res;
+}
+
+static int get_color(std::string reg) {
+    for (int i { 0 }; i < COLOR_N; i++) {
+        if (allocatable_regs[i] == reg) return i;
+    }
+    return -1;
+}
+
+class InterferenceGraph {
+public:
+    struct Move {
+        int x, y;
+        double weight;
+    };
+
+    /*
+     * nodes `0` to `COLOR_N - 1` are the precolored registers
+     */
+    InterferenceGraph(int virtual_node_n)
+        : adj(COLOR_N + virtual_node_n),
+        alias(COLOR_N + virtual_node_n),
+        costs(COLOR_N + virtual_node_n, 0),
+        save_costs(COLOR_N + virtual_node_n, 0),
+        colors(COLOR_N + virtual_node_n, -1) {
+        for (int i { 0 }; i < alias.size(); i++) {
+            alias[i] = i;
+        }
+        for (int i { 0 }; i < COLOR_N; i++) {
+            colors[i] = i;
+        }
+    }
+
+    static bool is_precolored(int node) { return node < COLOR_N; }
+
+    void add_edge(int u, int v) {
+        if (u == v || (is_precolored(u) && is_precolored(v))) return;
+        adj[u].insert(v);
+        adj[v].insert(u);
+    }
+
+    void add_cost(int node, double cost) { costs[node] += cost; }
+
+    /*
+     * `node` is live across a call, which would store and load it if it is
+     * given a caller-saved register
+     */
+    void add_call_crossing(int node, double weight) { save_costs[node] += 2 * weight; }
+
+    void add_move(int x, int y, double weight) { moves.push_back({ x, y, weight }); }
+
+    int find(int node) {
+        while (alias[node] != node) {
+            node = alias[node] = alias[alias[node]];
+        }
+        return node;
+    }
+
+    /*
+     * merge the two ends of every move whose merging cannot turn a colorable
+     * graph uncolorable: George's test against a precolored node, Briggs'
+     * test between two virtual nodes
+     */
+    void coalesce() {
+        std::stable_sort(moves.begin(), moves.end(), [](const Move& a, const Move& b) {
+            return a.weight > b.weight;
+        });
+
+        for (auto& move: moves) {
+            int x { find(move.x) }, y { find(move.y) };
+            if (is_precolored(x)) std::swap(x, y);
+
+            if (x == y || is_precolored(x) || adj[x].count(y) > 0) continue;
+            if (is_precolored(y) && y < CALLER_SAVED_N && save_costs[x] > 0) continue;
+
+            if (is_precolored(y) ? george_test(x, y) : briggs_test(x, y)) {
+                combine(x, y);
+            }
+        }
+    }
+
+    /*
+     * simplify, pushing high degree nodes optimistically in the order of
+     * `cost / degree`, then pop and pick colors, preferring the color of a
+     * move partner
+     */
+    void color() {
+        std::vector<int> degrees(adj.size());
+        std::vector<bool> is_removed(adj.size(), false);
+        std::vector<int> low, stack;
+        std::unordered_set<int> high;
+
+        for (int i { COLOR_N }; i < adj.size(); i++) {
+            if (find(i) != i) continue;
+
+            degrees[i] = adj[i].size();
+            if (degrees[i] < COLOR_N) low.push_back(i);
+            else high.insert(i);
+        }
+
+        auto remove = [&](int node) {
+            is_removed[node] = true;
+            stack.push_back(node);
+
+            for (int neighbor: adj[node]) {
+                if (is_precolored(neighbor) || is_removed[neighbor]) continue;
+
+                if (degrees[neighbor]-- == COLOR_N) {
+                    high.erase(neighbor);
+                    low.push_back(neighbor);
+                }
+            }
+        };
+
+        while (!low.empty() || !high.empty()) {
+            if (!low.empty()) {
+                int node { low.back() };
+                low.pop_back();
+                remove(node);
+                continue;
+            }
+
+            auto spill { *std::min_element(high.begin(), high.end(), [&](int a, int b) {
+                return costs[a] / degrees[a] < costs[b] / degrees[b];
+            }) };
+            high.erase(spill);
+            remove(spill);
+        }
+
+        std::unordered_map<int, std::vector<int>> partners;
+        for (auto& move: moves) {
+            int x { find(move.x) }, y { find(move.y) };
+            if (x == y) continue;
+            partners[x].push_back(y);
+            partners[y].push_back(x);
+        }
+
+        auto color_order { get_color_order() };
+        while (!stack.empty()) {
+            int node { stack.back() };
+            stack.pop_back();
+
+            bool is_color_used[COLOR_N] {};
+            for (int neighbor: adj[node]) {
+                int color { colors[find(neighbor)] };
+                if (color != -1) is_color_used[color] = true;
+            }
+
+            bool crosses_call { save_costs[node] > 0 };
+            auto is_free = [&](int color) {
+                return !is_color_used[color] && (!crosses_call || color >= CALLER_SAVED_N);
+            };
+
+            for (int partner: partners[node]) {
+                int color { colors[partner] };
+                if (color != -1 && is_free(color)) {
+                    colors[node] = color;
+                    break;
+                }
+            }
+
+            for (int color: color_order) {
+                if (colors[node] == -1 && is_free(color)) colors[node] = color;
+            }
+
+            if (colors[node] == -1 && crosses_call && save_costs[node] < costs[node]) {
+                for (int color: color_order) {
+                    if (colors[node] == -1 && color < CALLER_SAVED_N && !is_color_used[color]) colors[node] = color;
+                }
+            }
+        }
+    }
+
+    /*
+     * @return  color of `node`, -1 if it is spilled
+     */
+    int get_color(int node) { return colors[find(node)]; }
+
+private:
+    std::vector<std::unordered_set<int>> adj;
+    std::vector<int> alias;
+    std::vector<double> costs;
+    std::vector<double> save_costs;
+    std::vector<int> colors;
+    std::vector<Move> moves;
+
+    bool is_significant(int node) {
+        return is_precolored(node) || adj[node].size() >= COLOR_N;
+    }
+
+    bool george_test(int x, int precolored) {
+        for (int neighbor: adj[x]) {
+            if (!is_significant(neighbor)) continue;
+            if (is_precolored(neighbor) || adj[neighbor].count(precolored) > 0) continue;
+            return false;
+        }
+        return true;
+    }
+
+    bool briggs_test(int x, int y) {
+        auto neighbors { adj[x] };
+        neighbors.insert(adj[y].begin(), adj[y].end());
+
+        int significant_n { 0 };
+        for (int neighbor: neighbors) {
+            significant_n += is_significant(neighbor);
+        }
+        return significant_n < COLOR_N;
+    }
+
+    /*
+     * merge `x` into `y`
+     */
+    void combine(int x, int y) {
+        alias[x] = y;
+        costs[y] += costs[x];
+        save_costs[y] += save_costs[x];
+
+        for (int neighbor: adj[x]) {
+            adj[neighbor].erase(x);
+            add_edge(neighbor, y);
+        }
+        adj[x].clear();
+    }
+};
+
+std::vector<koopa::Id*> graph_coloring_allocate(const koopa::FuncDef* func_def) {
+    std::unordered_map<koopa::Id*, int> nodes;
+    auto candidates { std::vector<koopa::Id*>() };
+    for (auto* id: get_value_ids(func_def)) {
+        if (current_folded_ids.count(id) == 0) {
+            nodes.emplace(id, COLOR_N + candidates.size());
+            candidates.push_back(id);
+        }
+    }
+    int virtual_node_n { static_cast<int>(candidates.size()) };
+
+    /*
+     * the first eight parameters stay in the argument registers they arrive
+     * in, see `allocate_ids_storage_location`
+     */
+    auto formal_param_ids { func_def->get_formal_param_ids() };
+    for (int i { 0 }; i < formal_param_ids.size() && i < 8; i++) {
+        nodes.emplace(formal_param_ids[i], get_color("a" + std::to_string(i)));
+        candidates.push_back(formal_param_ids[i]);
+    }
+
+    auto node_of = [&](koopa::Id* id) {
+        auto res { nodes.find(id) };
+        return res == nodes.end() ? -1 : res->second;
+    };
+
+    std::vector<koopa::Id*> id_of_node(COLOR_N + virtual_node_n, nullptr);
+    for (auto [id, node]: nodes) {
+        id_of_node[node] = id;
+    }
+
+    // calls and the nodes live across them
+    std::vector<std::pair<koopa::FuncCall*, int>> call_crossings;
+
+    InterferenceGraph graph(virtual_node_n);
+
+    auto liveness { dataflow::analyze_liveness(func_def, candidates) };
+    auto& blocks { liveness.graph.blocks };
+    auto& cfg { dataflow::get_cfg(func_def) };
+
+    for (int i { 0 }; i < blocks.size(); i++) {
+        double weight { std::pow(LOOP_WEIGHT, std::min(cfg.get_loop_depth(i), MAX_LOOP_DEPTH)) };
+
+        std::unordered_set<int> live;
+        liveness.live_out[i].for_each([&](int number) {
+            live.insert(node_of(liveness.numbering.get_id(number)));
+        });
+
+        auto& stmts { blocks[i]->get_stmts() };
+        for (auto it { stmts.rbegin() }; it != stmts.rend(); it++) {
+            auto* stmt { *it };
+            auto* func_call { get_func_call(stmt) };
+
+            int def { stmt->get_def_id() == nullptr ? -1 : node_of(stmt->get_def_id()) };
+
+            // a `jump` defines the parameters of its target all at once
+            auto defs { std::vector<int>() };
+            for (auto* def_id: dataflow::get_def_ids(liveness.graph, i, stmt)) {
+                if (node_of(def_id) != -1) {
+                    defs.push_back(node_of(def_id));
+                }
+            }
+
+            if (func_call != nullptr) {
+                // the call clobbers every caller-saved register
+                for (int node: live) {
+                    if (node == def) continue;
+                    graph.add_call_crossing(node, weight);
+                    call_crossings.push_back({ func_call, node });
+                }
+                if (def != -1) {
+                    graph.add_move(def, get_color("a0"), weight);
+                }
+            }
+
+            for (int def: defs) {
+                for (int node: live) {
+                    graph.add_edge(def, node);
+                }
+                graph.add_cost(def, weight);
+            }
+            for (int def: defs) {
+                live.erase(def);
+            }
+
+            for (auto* id: stmt->get_used_ids()) {
+                int node { node_of(id) };
+                if (node == -1) continue;
+
+                graph.add_cost(node, weight);
+                live.insert(node);
+            }
+
+            if (func_call != nullptr) {
+                /*
+                 * moving the arguments into a0-a7 overwrites each of them, except
+                 * for the value that is itself passed in it
+                 */
+                auto args { func_call->get_args() };
+                int reg_arg_n { std::min(static_cast<int>(args.size()), 8) };
+
+                for (int node: live) {
+                    for (int j { 0 }; j < reg_arg_n; j++) {
+                        auto* arg_id { dynamic_cast<koopa::Id*>(args[j]) };
+                        if (arg_id == nullptr || node_of(arg_id) != node) {
+                            graph.add_edge(node, get_color("a" + std::to_string(j)));
+                        }
+                    }
+                }
+
+                for (int j { 0 }; j < reg_arg_n; j++) {
+                    auto* arg_id { dynamic_cast<koopa::Id*>(args[j]) };
+                    if (arg_id != nullptr && node_of(arg_id) != -1) {
+                        graph.add_move(node_of(arg_id), get_color("a" + std::to_string(j)), weight);
+                    }
+                }
+            }
+
+            /*
+             * a parameter sharing the register of its argument needs no copy,
+             * see `parallel_copy_to_riscv`
+             */
+            if (auto* jump { dynamic_cast<koopa::Jump*>(stmt) }; jump != nullptr && !jump->get_args().empty()) {
+                auto& params { blocks[liveness.graph.succs[i][0]]->get_params() };
+                auto args { jump->get_args() };
+                for (int j { 0 }; j < args.size(); j++) {
+                    auto* arg_id { dynamic_cast<koopa::Id*>(args[j]) };
+                    if (arg_id != nullptr && node_of(arg_id) != -1 && node_of(params[j]) != -1) {
+                        graph.add_move(node_of(params[j]), node_of(arg_id), weight);
+                    }
+                }
+            }
+
+            if (dynamic_cast<koopa::Return*>(stmt) != nullptr) {
+                for (auto* id: stmt->get_used_ids()) {
+                    if (node_of(id) != -1) {
+                        graph.add_move(node_of(id), get_color("a0"), weight);
+                    }
+                }
+            }
+        }
+    }
+
+    graph.coalesce();
+    graph.color();
+
+    for (auto [func_call, node]: call_crossings) {
+        int color { graph.get_color(node) };
+        if (color != -1 && color < CALLER_SAVED_N) {
+            current_call_saved_ids[func_call].push_back(id_of_node[node]);
+        }
+    }
+
+    auto stack_ids { get_pseudo_ids(func_def) };
+    for (int i { 0 }; i < virtual_node_n; i++) {
+        int color { graph.get_color(COLOR_N + i) };
+        if (color == -1) {
+            stack_ids.push_back(candidates[i]);
+        }
+        else {
+            id_storage_map.register_id(candidates[i], new Register(allocatable_regs[color]));
+        }
+    }
+
+    return stack_ids;
+}
+
+}
@@ -104,7 +104,7 @@ Branch::Branch(Value* cond, Label target1, Label target2)
     assert(cond);
 }
 
-Jump::Jump(Label target): target(target) {}
+Jump::Jump(Label target, std::vector<Value*> args): target(target), args(args) {}
 
 Return::Return(): return_type(ReturnType::NotHasRetVal) {}
 
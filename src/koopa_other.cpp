@@ -77,7 +77,8 @@ std::string Id::get_lit() const { return lit; }
 
 Id* FuncDef::get_id() const { return id; }
 std::vector<Id*> FuncDef::get_formal_param_ids() const { return formal_param_ids; }
-std::vector<Block*> FuncDef::get_blocks() const { return blocks; }
+const std::vector<Block*>& FuncDef::get_blocks() const { return blocks; }
+void FuncDef::set_blocks(std::vector<Block*> blocks) { this->blocks = blocks; }
 
 int ConstInitializer::get_val() const { return val; }
 
@@ -86,8 +87,57 @@ std::vector<Value*> FuncCall::get_args() const { return args; };
 
 Rvalue* SymbolDef::get_val() const { return val; }
 
+Id* MemoryDecl::get_pseudo_id() const { return pseudo_id; }
+
+Id* Load::get_addr() const { return addr; }
+
+Id* GetPtr::get_base() const { return base; }
+Value* GetPtr::get_offset() const { return offset; }
+unsigned GetPtr::get_stride() const { return base->get_type()->unwrap()->get_byte_size(); }
+
+Id* GetElemPtr::get_base() const { return base; }
+Value* GetElemPtr::get_offset() const { return offset; }
+unsigned GetElemPtr::get_stride() const { return base->get_type()->unwrap()->unwrap()->get_byte_size(); }
+
+Value* StoreValue::get_value() const { return value; }
+Id* StoreValue::get_addr() const { return addr; }
+Id* StoreInitializer::get_addr() const { return addr; }
+
+Value* Expr::get_lv() const { return lv; }
+Value* Expr::get_rv() const { return rv; }
+
+std::vector<Value*> Jump::get_args() const { return args; }
+void Jump::set_args(std::vector<Value*> args) { this->args = args; }
+
+Value* Branch::get_cond() const { return cond; }
+
+void Branch::set_target_label(int index, Label label) {
+    assert(index == 0 || index == 1);
+    (index == 0 ? target1 : target2) = label;
+}
+
+std::vector<Value*> Branch::get_target_args(int index) const {
+    assert(index == 0 || index == 1);
+    return index == 0 ? args1 : args2;
+}
+
+void Branch::set_target_args(int index, std::vector<Value*> args) {
+    assert(index == 0 || index == 1);
+    (index == 0 ? args1 : args2) = args;
+}
+
+Value* Return::get_val() const { return return_type == ReturnType::HasRetVal ? val : nullptr; }
+
+void GlobalMemoryDecl::set_read_only() { is_read_only_bool = true; }
+bool GlobalMemoryDecl::is_read_only() const { return is_read_only_bool; }
+
+GlobalMemoryDecl* GlobalSymbolDef::get_decl() const { return decl; }
+
 Label Block::get_label() const { return label;}
 std::vector<Stmt*>& Block::get_stmts() { return stmts; }
+std::vector<Id*>& Block::get_params() { return params; }
+
+std::vector<GlobalStmt*> Program::get_global_stmts() const { return global_stmts; }
 
 bool Id::is_const() {
     return is_const_bool;
@@ -147,6 +197,17 @@ unsigned Rvalue::get_func_call_param_n() const {
     return 0;
 }
 
+bool Rvalue::is_cmp() const {
+    return false;
+}
+
+bool Eq::is_cmp() const { return true; }
+bool Ne::is_cmp() const { return true; }
+bool Gt::is_cmp() const { return true; }
+bool Lt::is_cmp() const { return true; }
+bool Ge::is_cmp() const { return true; }
+bool Le::is_cmp() const { return true; }
+
 bool FuncCall::is_func_call() const {
     return true;
 }
@@ -155,6 +216,182 @@ unsigned FuncCall::get_func_call_param_n() const {
     return args.size();
 }
 
+/*
+ * append `value` to `ids` if it is an identifier
+ */
+static void push_if_id(std::vector<Id*>& ids, Value* value) {
+    auto* id { dynamic_cast<Id*>(value) };
+    if (id != nullptr) {
+        ids.push_back(id);
+    }
+}
+
+std::vector<Id*> Stmt::get_used_ids() const { return {}; }
+Id* Stmt::get_def_id() const { return nullptr; }
+std::vector<Label> Stmt::get_target_labels() const { return {}; }
+
+std::vector<Id*> Rvalue::get_used_ids() const { return {}; }
+
+std::vector<Id*> Load::get_used_ids() const { return { addr }; }
+
+std::vector<Id*> GetPtr::get_used_ids() const {
+    auto res { std::vector<Id*> { base } };
+    push_if_id(res, offset);
+    return res;
+}
+
+std::vector<Id*> GetElemPtr::get_used_ids() const {
+    auto res { std::vector<Id*> { base } };
+    push_if_id(res, offset);
+    return res;
+}
+
+std::vector<Id*> Expr::get_used_ids() const {
+    auto res { std::vector<Id*>() };
+    push_if_id(res, lv);
+    push_if_id(res, rv);
+    return res;
+}
+
+std::vector<Id*> FuncCall::get_used_ids() const {
+    auto res { std::vector<Id*>() };
+    for (auto* arg: args) {
+        push_if_id(res, arg);
+    }
+    return res;
+}
+
+std::vector<Id*> SymbolDef::get_used_ids() const { return val->get_used_ids(); }
+Id* SymbolDef::get_def_id() const { return id; }
+
+std::vector<Id*> StoreValue::get_used_ids() const {
+    auto res { std::vector<Id*>() };
+    push_if_id(res, value);
+    res.push_back(addr);
+    return res;
+}
+
+std::vector<Id*> StoreInitializer::get_used_ids() const { return { addr }; }
+
+std::vector<Id*> Branch::get_used_ids() const {
+    auto res { std::vector<Id*>() };
+    push_if_id(res, cond);
+    for (auto* arg: args1) {
+        push_if_id(res, arg);
+    }
+    for (auto* arg: args2) {
+        push_if_id(res, arg);
+    }
+    return res;
+}
+
+std::vector<Label> Branch::get_target_labels() const { return { target1, target2 }; }
+
+std::vector<Id*> Jump::get_used_ids() const {
+    auto res { std::vector<Id*>() };
+    for (auto* arg: args) {
+        push_if_id(res, arg);
+    }
+    return res;
+}
+
+std::vector<Label> Jump::get_target_labels() const { return { target }; }
+
+std::vector<Id*> Return::get_used_ids() const {
+    auto res { std::vector<Id*>() };
+    if (return_type == ReturnType::HasRetVal) {
+        push_if_id(res, val);
+    }
+    return res;
+}
+
+/*
+ * `value` replaced by what it maps to in `values`, if it is a key of it
+ */
+static void replace_if_mapped(Value*& value, const std::unordered_map<Id*, Value*>& values) {
+    auto* id { dynamic_cast<Id*>(value) };
+    if (id == nullptr) return;
+
+    auto it { values.find(id) };
+    if (it != values.end()) {
+        value = it->second;
+    }
+}
+
+/*
+ * as above, for operands that must stay identifiers, i.e. addresses
+ */
+static void replace_if_mapped(Id*& id, const std::unordered_map<Id*, Value*>& values) {
+    auto it { values.find(id) };
+    if (it != values.end()) {
+        id = dynamic_cast<Id*>(it->second);
+        assert(id != nullptr);
+    }
+}
+
+void Stmt::replace_uses(const std::unordered_map<Id*, Value*>& values) {}
+void Rvalue::replace_uses(const std::unordered_map<Id*, Value*>& values) {}
+
+void Load::replace_uses(const std::unordered_map<Id*, Value*>& values) {
+    replace_if_mapped(addr, values);
+}
+
+void GetPtr::replace_uses(const std::unordered_map<Id*, Value*>& values) {
+    replace_if_mapped(base, values);
+    replace_if_mapped(offset, values);
+}
+
+void GetElemPtr::replace_uses(const std::unordered_map<Id*, Value*>& values) {
+    replace_if_mapped(base, values);
+    replace_if_mapped(offset, values);
+}
+
+void Expr::replace_uses(const std::unordered_map<Id*, Value*>& values) {
+    replace_if_mapped(lv, values);
+    replace_if_mapped(rv, values);
+}
+
+void FuncCall::replace_uses(const std::unordered_map<Id*, Value*>& values) {
+    for (auto*& arg: args) {
+        replace_if_mapped(arg, values);
+    }
+}
+
+void SymbolDef::replace_uses(const std::unordered_map<Id*, Value*>& values) {
+    val->replace_uses(values);
+}
+
+void StoreValue::replace_uses(const std::unordered_map<Id*, Value*>& values) {
+    replace_if_mapped(value, values);
+    replace_if_mapped(addr, values);
+}
+
+void StoreInitializer::replace_uses(const std::unordered_map<Id*, Value*>& values) {
+    replace_if_mapped(addr, values);
+}
+
+void Branch::replace_uses(const std::unordered_map<Id*, Value*>& values) {
+    replace_if_mapped(cond, values);
+    for (auto*& arg: args1) {
+        replace_if_mapped(arg, values);
+    }
+    for (auto*& arg: args2) {
+        replace_if_mapped(arg, values);
+    }
+}
+
+void Jump::replace_uses(const std::unordered_map<Id*, Value*>& values) {
+    for (auto*& arg: args) {
+        replace_if_mapped(arg, values);
+    }
+}
+
+void Return::replace_uses(const std::unordered_map<Id*, Value*>& values) {
+    if (return_type == ReturnType::HasRetVal) {
+        replace_if_mapped(val, values);
+    }
+}
+
 bool SymbolDef::is_func_call() const {
     return val->is_func_call();
 }
@@ -1,402 +1,1220 @@
 #include "koopa.h"
 #include "name.h"
 #include "riscv_trans.h"
+#include "machine_ir.h"
+#include "peephole.h"
+#include "block_layout.h"
+#include "compress.h"
+#include "strength_reduction.h"
+#include "address_lowering.h"
+#include "allocate.h"
+#include "cfg.h"
+#include "out_of_ssa.h"
+#include "def.h"
 #include "value_manager.h"
 
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace koopa {
 
-riscv_trans::Register Id::value_to_riscv(std::string& str) const {
-    return riscv_trans::id_storage_map.get_storage(this)->get(str);
+riscv_trans::Register Id::value_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return riscv_trans::id_storage_map.get_storage(this)->get(mbb);
 }
 
-riscv_trans::Register Const::value_to_riscv(std::string& str) const {
+riscv_trans::Register Const::value_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
     auto target_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
-    str += build_inst("li", target_reg.get_lit(), std::to_string(val));
+    mbb += riscv_trans::MachineInstr(riscv_trans::Opcode::Li, { target_reg, val });
     return target_reg;
 }
 
-riscv_trans::Register MemoryDecl::rvalue_to_riscv(std::string& str) const {
-    return riscv_trans::id_storage_map.get_storage(pseudo_id)->get_addr(str);
+riscv_trans::Register MemoryDecl::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return riscv_trans::id_storage_map.get_storage(pseudo_id)->get_addr(mbb);
 }
 
-riscv_trans::Register Load::rvalue_to_riscv(std::string& str) const {
-    auto addr_reg { riscv_trans::id_storage_map.get_storage(addr)->get(str) };
+riscv_trans::Register Load::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    int offset;
+    auto addr_reg { riscv_trans::address_to_riscv(mbb, riscv_trans::get_address(addr), offset) };
 
     auto target_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
 
-    str += build_sw_lw("lw", target_reg, 0, addr_reg);
+    mbb += build_sw_lw(riscv_trans::Opcode::Lw, target_reg, offset, addr_reg);
 
     riscv_trans::temp_reg_manager.refresh_reg(addr_reg);
 
     return target_reg;
 }
 
-riscv_trans::Register GetElemPtr::rvalue_to_riscv(std::string& str) const {
-    auto addr_reg { base->value_to_riscv(str) };
-    auto offset_reg { offset->value_to_riscv(str) };
-    auto size_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
-
-    str += build_inst(
-        "li", size_reg.get_lit(), 
-        std::to_string(base->get_type()->unwrap()->unwrap()->get_byte_size())
-    );
-    str += build_inst("mul", offset_reg.get_lit(), offset_reg.get_lit(), size_reg.get_lit());
-    str += build_inst("add", addr_reg.get_lit(), addr_reg.get_lit(), offset_reg.get_lit());
-
-    riscv_trans::temp_reg_manager.refresh_reg(size_reg);
-    riscv_trans::temp_reg_manager.refresh_reg(offset_reg);
-    return addr_reg;
-}
-
-riscv_trans::Register GetPtr::rvalue_to_riscv(std::string& str) const {
-    auto addr_reg { base->value_to_riscv(str) };
-    auto offset_reg { offset->value_to_riscv(str) };
-    auto size_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
-
-    str += build_inst(
-        "li", size_reg.get_lit(), 
-        std::to_string(base->get_type()->unwrap()->get_byte_size())
-    );
-    str += build_inst("mul", offset_reg.get_lit(), offset_reg.get_lit(), size_reg.get_lit());
-    str += build_inst("add", addr_reg.get_lit(), addr_reg.get_lit(), offset_reg.get_lit());
-
-    riscv_trans::temp_reg_manager.refresh_reg(size_reg);
-    riscv_trans::temp_reg_manager.refresh_reg(offset_reg);
-    return addr_reg;
-}
-
 static riscv_trans::Register expr_inst_builder(
-    std::string inst, 
+    riscv_trans::Opcode opcode, 
     riscv_trans::Register first_reg, riscv_trans::Register second_reg, 
-    std::string& str
+    riscv_trans::MachineBasicBlock& mbb
 ) {
     auto target_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
-    str += build_inst(inst, target_reg.get_lit(), first_reg.get_lit(), second_reg.get_lit());
+    mbb += riscv_trans::MachineInstr(opcode, { target_reg, first_reg, second_reg });
     riscv_trans::temp_reg_manager.refresh_reg(first_reg);
     riscv_trans::temp_reg_manager.refresh_reg(second_reg);
     return target_reg;
 }
 
 static riscv_trans::Register expr_inst_builder(
-    std::string inst, 
+    riscv_trans::Opcode opcode, 
     riscv_trans::Register first_reg, 
-    std::string& str
+    riscv_trans::MachineBasicBlock& mbb
 ) {
     auto target_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
-    str += build_inst(inst, target_reg.get_lit(), first_reg.get_lit());
+    mbb += riscv_trans::MachineInstr(opcode, { target_reg, first_reg });
     riscv_trans::temp_reg_manager.refresh_reg(first_reg);
     return target_reg;
 }
 
-riscv_trans::Register Eq::rvalue_to_riscv(std::string& str) const {
-    if (lv->is_const()) {
-        return Eq(rv, lv).rvalue_to_riscv(str);
-    }
+/*
+ * materialize `address`, adding its constant offset to the rest
+ */
+static riscv_trans::Register address_value_to_riscv(
+    const riscv_trans::Address& address, 
+    riscv_trans::MachineBasicBlock& mbb
+) {
+    int offset;
+    auto addr_reg { riscv_trans::address_to_riscv(mbb, address, offset) };
+    if (offset == 0) return addr_reg;
+
+    auto target_reg {
+        riscv_trans::temp_reg_manager.is_temp_reg(addr_reg) 
+            ? addr_reg : riscv_trans::temp_reg_manager.get_unused_reg()
+    };
+    mbb += build_i_type_inst(riscv_trans::Opcode::Add, target_reg, addr_reg, offset);
+    return target_reg;
+}
 
-    if (rv->is_const()) {
-        auto lv_reg { lv->value_to_riscv(str) };
-        auto tmp_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
+riscv_trans::Register GetElemPtr::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return address_value_to_riscv(riscv_trans::get_address(base, offset, get_stride()), mbb);
+}
 
-        str += build_i_type_inst("xor", tmp_reg, lv_reg, rv->get_val());
+riscv_trans::Register GetPtr::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return address_value_to_riscv(riscv_trans::get_address(base, offset, get_stride()), mbb);
+}
 
-        riscv_trans::temp_reg_manager.refresh_reg(lv_reg);
+enum class BinaryOp { Eq, Ne, Gt, Lt, Ge, Le, Add, Sub, And, Or, Xor, Shl, Shr, Sar, None };
 
-        return expr_inst_builder("seqz", tmp_reg, str);
-    }
+/*
+ * `seqz`, `snez` or `xori 1` applied to the result of some comparisons
+ */
+enum class PostOp { None, Seqz, Snez, Not };
 
-    auto tmp_reg { expr_inst_builder("xor", lv->value_to_riscv(str), rv->value_to_riscv(str), str) };
-    return expr_inst_builder("seqz", tmp_reg, str);
+/*
+ * how `lv op rv` is selected
+ *
+ * `reg_opcode` takes two registers. If `rv` is a constant `c` and `get_imm(c)`
+ * fits in IMM12, `imm_opcode` takes that as its immediate instead, sparing
+ * the `li`. A constant `lv` is moved to the right as `rv swapped lv`.
+ */
+struct BinarySelection {
+    riscv_trans::Opcode reg_opcode;
+    PostOp reg_post_op;
+    riscv_trans::Opcode imm_opcode;
+    PostOp imm_post_op;
+    int64_t (*get_imm)(int64_t c);
+    BinaryOp swapped;
+};
+
+static int64_t same_imm(int64_t c) { return c; }
+static int64_t neg_imm(int64_t c) { return -c; }
+static int64_t inc_imm(int64_t c) { return c + 1; }
+static int64_t shamt_imm(int64_t c) { return c & 31; }
+
+static const BinarySelection binary_selections[] {
+    // x == c  =>  seqz (xori x, c)
+    { riscv_trans::Opcode::Xor, PostOp::Seqz, riscv_trans::Opcode::Xori, PostOp::Seqz, same_imm, BinaryOp::Eq },
+    { riscv_trans::Opcode::Xor, PostOp::Snez, riscv_trans::Opcode::Xori, PostOp::Snez, same_imm, BinaryOp::Ne },
+    // x > c  =>  !(x < c + 1)
+    { riscv_trans::Opcode::Sgt, PostOp::None, riscv_trans::Opcode::Slti, PostOp::Not, inc_imm, BinaryOp::Lt },
+    { riscv_trans::Opcode::Slt, PostOp::None, riscv_trans::Opcode::Slti, PostOp::None, same_imm, BinaryOp::Gt },
+    { riscv_trans::Opcode::Slt, PostOp::Not, riscv_trans::Opcode::Slti, PostOp::Not, same_imm, BinaryOp::Le },
+    // x <= c  =>  x < c + 1
+    { riscv_trans::Opcode::Sgt, PostOp::Not, riscv_trans::Opcode::Slti, PostOp::None, inc_imm, BinaryOp::Ge },
+    { riscv_trans::Opcode::Add, PostOp::None, riscv_trans::Opcode::Addi, PostOp::None, same_imm, BinaryOp::Add },
+    // x - c  =>  x + (-c)
+    { riscv_trans::Opcode::Sub, PostOp::None, riscv_trans::Opcode::Addi, PostOp::None, neg_imm, BinaryOp::None },
+    { riscv_trans::Opcode::And, PostOp::None, riscv_trans::Opcode::Andi, PostOp::None, same_imm, BinaryOp::And },
+    { riscv_trans::Opcode::Or, PostOp::None, riscv_trans::Opcode::Ori, PostOp::None, same_imm, BinaryOp::Or },
+    { riscv_trans::Opcode::Xor, PostOp::None, riscv_trans::Opcode::Xori, PostOp::None, same_imm, BinaryOp::Xor },
+    // only the lower 5 bits of the shift amount count, as for `sll`
+    { riscv_trans::Opcode::Sll, PostOp::None, riscv_trans::Opcode::Slli, PostOp::None, shamt_imm, BinaryOp::None },
+    { riscv_trans::Opcode::Srl, PostOp::None, riscv_trans::Opcode::Srli, PostOp::None, shamt_imm, BinaryOp::None },
+    { riscv_trans::Opcode::Sra, PostOp::None, riscv_trans::Opcode::Srai, PostOp::None, shamt_imm, BinaryOp::None },
+};
+
+static riscv_trans::Register post_op_to_riscv(
+    PostOp post_op, riscv_trans::Register source_reg, 
+    riscv_trans::MachineBasicBlock& mbb
+) {
+    switch (post_op) {
+        case PostOp::None:
+            return source_reg;
+        case PostOp::Seqz:
+            return expr_inst_builder(riscv_trans::Opcode::Seqz, source_reg, mbb);
+        case PostOp::Snez:
+            return expr_inst_builder(riscv_trans::Opcode::Snez, source_reg, mbb);
+        case PostOp::Not: {
+            auto target_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
+            mbb += riscv_trans::MachineInstr(riscv_trans::Opcode::Xori, { target_reg, source_reg, 1 });
+            riscv_trans::temp_reg_manager.refresh_reg(source_reg);
+            return target_reg;
+        }
+    }
+    return source_reg;
 }
 
-riscv_trans::Register Ne::rvalue_to_riscv(std::string& str) const {
-    if (lv->is_const()) {
-        return Ne(rv, lv).rvalue_to_riscv(str);
+static riscv_trans::Register binary_to_riscv(
+    BinaryOp op, Value* lv, Value* rv, 
+    riscv_trans::MachineBasicBlock& mbb
+) {
+    auto& selection { binary_selections[static_cast<int>(op)] };
+
+    if (lv->is_const() && !rv->is_const() && selection.swapped != BinaryOp::None) {
+        return binary_to_riscv(selection.swapped, rv, lv, mbb);
     }
 
-    if (rv->is_const()) {
-        auto lv_reg { lv->value_to_riscv(str) };
-        auto tmp_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
+    if (!lv->is_const() && rv->is_const()) {
+        auto imm { selection.get_imm(rv->get_val()) };
 
-        str += build_i_type_inst("xor", tmp_reg, lv_reg, rv->get_val());
-        
-        riscv_trans::temp_reg_manager.refresh_reg(lv_reg);
+        if (imm >= riscv_trans::IMM12_MIN && imm <= riscv_trans::IMM12_MAX) {
+            auto lv_reg { lv->value_to_riscv(mbb) };
+
+            // `addi`, `xori` and the like by 0 leave `lv` as it is
+            bool is_identity { imm == 0 && selection.imm_opcode != riscv_trans::Opcode::Slti 
+                && selection.imm_opcode != riscv_trans::Opcode::Andi };
+            if (is_identity) {
+                return post_op_to_riscv(selection.imm_post_op, lv_reg, mbb);
+            }
 
-        return expr_inst_builder("snez", tmp_reg, str);
+            auto target_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
+            mbb += riscv_trans::MachineInstr(selection.imm_opcode, { target_reg, lv_reg, static_cast<int>(imm) });
+            riscv_trans::temp_reg_manager.refresh_reg(lv_reg);
+
+            return post_op_to_riscv(selection.imm_post_op, target_reg, mbb);
+        }
     }
 
-    auto tmp_reg { expr_inst_builder("xor", lv->value_to_riscv(str), rv->value_to_riscv(str), str) };
-    return expr_inst_builder("snez", tmp_reg, str);
+    auto target_reg { expr_inst_builder(selection.reg_opcode, lv->value_to_riscv(mbb), rv->value_to_riscv(mbb), mbb) };
+    return post_op_to_riscv(selection.reg_post_op, target_reg, mbb);
 }
 
-riscv_trans::Register Gt::rvalue_to_riscv(std::string& str) const {
-    return expr_inst_builder("sgt", lv->value_to_riscv(str), rv->value_to_riscv(str), str);
+riscv_trans::Register Eq::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return binary_to_riscv(BinaryOp::Eq, lv, rv, mbb);
 }
 
-riscv_trans::Register Lt::rvalue_to_riscv(std::string& str) const {
-    return expr_inst_builder("slt", lv->value_to_riscv(str), rv->value_to_riscv(str), str);
+riscv_trans::Register Ne::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return binary_to_riscv(BinaryOp::Ne, lv, rv, mbb);
 }
 
-riscv_trans::Register Ge::rvalue_to_riscv(std::string& str) const {
-    auto tmp_reg { expr_inst_builder("slt", lv->value_to_riscv(str), rv->value_to_riscv(str), str) };
-    
-    auto target_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
-    
-    str += build_i_type_inst("xor", target_reg, tmp_reg, 1);
+riscv_trans::Register Gt::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return binary_to_riscv(BinaryOp::Gt, lv, rv, mbb);
+}
 
-    riscv_trans::temp_reg_manager.refresh_reg(tmp_reg);
+riscv_trans::Register Lt::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return binary_to_riscv(BinaryOp::Lt, lv, rv, mbb);
+}
 
-    return target_reg;
+riscv_trans::Register Ge::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return binary_to_riscv(BinaryOp::Ge, lv, rv, mbb);
 }
 
-riscv_trans::Register Le::rvalue_to_riscv(std::string& str) const {
-    auto tmp_reg { expr_inst_builder("sgt", lv->value_to_riscv(str), rv->value_to_riscv(str), str) };
+riscv_trans::Register Le::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return binary_to_riscv(BinaryOp::Le, lv, rv, mbb);
+}
 
+/*
+ * `b<cond> first, second, target`, reading a constant 0 from `zero`
+ */
+static void cmp_branch_builder(
+    riscv_trans::Opcode opcode, 
+    Value* first, Value* second, std::string target,
+    riscv_trans::MachineBasicBlock& mbb
+) {
+    auto operand_to_riscv { [&mbb](Value* val) {
+        if (val->is_const() && val->get_val() == 0) {
+            return riscv_trans::Register("zero");
+        }
+        return val->value_to_riscv(mbb);
+    } };
+
+    auto first_reg { operand_to_riscv(first) };
+    auto second_reg { operand_to_riscv(second) };
+    mbb += riscv_trans::MachineInstr(opcode, { first_reg, second_reg, target });
+    riscv_trans::temp_reg_manager.refresh_reg(first_reg);
+    riscv_trans::temp_reg_manager.refresh_reg(second_reg);
+}
+
+void Rvalue::cmp_branch_to_riscv(riscv_trans::MachineBasicBlock& mbb, std::string target) const {
+    assert(is_cmp());
+}
+
+void Eq::cmp_branch_to_riscv(riscv_trans::MachineBasicBlock& mbb, std::string target) const {
+    cmp_branch_builder(riscv_trans::Opcode::Beq, lv, rv, target, mbb);
+}
+
+void Ne::cmp_branch_to_riscv(riscv_trans::MachineBasicBlock& mbb, std::string target) const {
+    cmp_branch_builder(riscv_trans::Opcode::Bne, lv, rv, target, mbb);
+}
+
+void Gt::cmp_branch_to_riscv(riscv_trans::MachineBasicBlock& mbb, std::string target) const {
+    cmp_branch_builder(riscv_trans::Opcode::Blt, rv, lv, target, mbb);
+}
+
+void Lt::cmp_branch_to_riscv(riscv_trans::MachineBasicBlock& mbb, std::string target) const {
+    cmp_branch_builder(riscv_trans::Opcode::Blt, lv, rv, target, mbb);
+}
+
+void Ge::cmp_branch_to_riscv(riscv_trans::MachineBasicBlock& mbb, std::string target) const {
+    cmp_branch_builder(riscv_trans::Opcode::Bge, lv, rv, target, mbb);
+}
+
+void Le::cmp_branch_to_riscv(riscv_trans::MachineBasicBlock& mbb, std::string target) const {
+    cmp_branch_builder(riscv_trans::Opcode::Bge, rv, lv, target, mbb);
+}
+
+riscv_trans::Register Add::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return binary_to_riscv(BinaryOp::Add, lv, rv, mbb);
+}
+
+riscv_trans::Register Sub::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return binary_to_riscv(BinaryOp::Sub, lv, rv, mbb);
+}
+
+/*
+ * `lv op val` by `builder` of `strength_reduction.h`
+ */
+static riscv_trans::Register by_const_builder(
+    void (*builder)(riscv_trans::MachineBasicBlock&, riscv_trans::Register, riscv_trans::Register, int),
+    Value* lv, int val,
+    riscv_trans::MachineBasicBlock& mbb
+) {
+    auto lv_reg { lv->value_to_riscv(mbb) };
     auto target_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
-    
-    str += build_i_type_inst("xor", target_reg, tmp_reg, 1);
-    
-    riscv_trans::temp_reg_manager.refresh_reg(tmp_reg);
+
+    builder(mbb, target_reg, lv_reg, val);
+
+    riscv_trans::temp_reg_manager.refresh_reg(lv_reg);
 
     return target_reg;
 }
 
-riscv_trans::Register Add::rvalue_to_riscv(std::string& str) const {
-    if (lv->is_const()) {
-        return Add(rv, lv).rvalue_to_riscv(str);
+riscv_trans::Register Mul::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    if (lv->is_const() && !rv->is_const()) {
+        return Mul(rv, lv).rvalue_to_riscv(mbb);
     }
 
     if (rv->is_const()) {
-        auto lv_reg { lv->value_to_riscv(str) };
+        return by_const_builder(riscv_trans::mul_by_const_to_riscv, lv, rv->get_val(), mbb);
+    }
 
-        auto target_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
-        
-        str += build_i_type_inst("add", target_reg, lv_reg, rv->get_val());
+    return expr_inst_builder(riscv_trans::Opcode::Mul, lv->value_to_riscv(mbb), rv->value_to_riscv(mbb), mbb);
+}
 
-        riscv_trans::temp_reg_manager.refresh_reg(lv_reg);
+riscv_trans::Register Div::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    if (!lv->is_const() && rv->is_const()) {
+        return by_const_builder(riscv_trans::div_by_const_to_riscv, lv, rv->get_val(), mbb);
+    }
 
-        return target_reg;
+    return expr_inst_builder(riscv_trans::Opcode::Div, lv->value_to_riscv(mbb), rv->value_to_riscv(mbb), mbb);
+}
+
+riscv_trans::Register Mod::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    if (!lv->is_const() && rv->is_const()) {
+        return by_const_builder(riscv_trans::rem_by_const_to_riscv, lv, rv->get_val(), mbb);
     }
 
-    return expr_inst_builder("add", lv->value_to_riscv(str), rv->value_to_riscv(str), str);
+    return expr_inst_builder(riscv_trans::Opcode::Rem, lv->value_to_riscv(mbb), rv->value_to_riscv(mbb), mbb);
 }
 
-riscv_trans::Register Sub::rvalue_to_riscv(std::string& str) const {
-    return expr_inst_builder("sub", lv->value_to_riscv(str), rv->value_to_riscv(str), str);
+riscv_trans::Register And::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return binary_to_riscv(BinaryOp::And, lv, rv, mbb);
 }
 
-riscv_trans::Register Mul::rvalue_to_riscv(std::string& str) const {
-    return expr_inst_builder("mul", lv->value_to_riscv(str), rv->value_to_riscv(str), str);
+riscv_trans::Register Or::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return binary_to_riscv(BinaryOp::Or, lv, rv, mbb);
 }
 
-riscv_trans::Register Div::rvalue_to_riscv(std::string& str) const {
-    return expr_inst_builder("div", lv->value_to_riscv(str), rv->value_to_riscv(str), str);
+riscv_trans::Register Xor::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return binary_to_riscv(BinaryOp::Xor, lv, rv, mbb);
 }
 
-riscv_trans::Register Mod::rvalue_to_riscv(std::string& str) const {
-    return expr_inst_builder("rem", lv->value_to_riscv(str), rv->value_to_riscv(str), str);
+
+riscv_trans::Register Shl::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return binary_to_riscv(BinaryOp::Shl, lv, rv, mbb);
 }
 
-riscv_trans::Register And::rvalue_to_riscv(std::string& str) const {
-    if (lv->is_const()) {
-        return And(rv, lv).rvalue_to_riscv(str);
-    }
+riscv_trans::Register Shr::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return binary_to_riscv(BinaryOp::Shr, lv, rv, mbb);
+}
 
-    if (rv->is_const()) {
-        auto lv_reg { lv->value_to_riscv(str) };
+riscv_trans::Register Sar::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    return binary_to_riscv(BinaryOp::Sar, lv, rv, mbb);
+}
 
-        auto target_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
-        
-        str += build_i_type_inst("and", target_reg, lv_reg, rv->get_val());
+void StoreValue::stmt_to_riscv(riscv_trans::MachineModule& module, riscv_trans::TransMode trans_mode) const {
+    auto& mbb { module.get_insert_block() };
 
-        riscv_trans::temp_reg_manager.refresh_reg(lv_reg);
+    mbb += build_comment(this);
 
-        return target_reg;
-    }
+    int offset;
+    auto addr_reg { riscv_trans::address_to_riscv(mbb, riscv_trans::get_address(addr), offset) };
+
+    auto val_reg { value->value_to_riscv(mbb) };
+
+    mbb += build_sw_lw(riscv_trans::Opcode::Sw, val_reg, offset, addr_reg);
 
-    return expr_inst_builder("and", lv->value_to_riscv(str), rv->value_to_riscv(str), str);
+    riscv_trans::temp_reg_manager.refresh_reg(val_reg);
+    riscv_trans::temp_reg_manager.refresh_reg(addr_reg);
 }
 
-riscv_trans::Register Or::rvalue_to_riscv(std::string& str) const {
-    if (lv->is_const()) {
-        return Or(rv, lv).rvalue_to_riscv(str);
-    }
+/*
+ * runs of at least `ZERO_LOOP_MIN_RUN` zeros in a local array initializer are
+ * cleared by a loop storing `ZERO_LOOP_UNROLL` words an iteration, shorter
+ * ones by a `sw zero` each
+ */
+static constexpr int ZERO_LOOP_MIN_RUN = 32;
+static constexpr int ZERO_LOOP_UNROLL = 8;
 
-    if (rv->is_const()) {
-        auto lv_reg { lv->value_to_riscv(str) };
+static int zero_loop_count { 0 };
 
-        auto target_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
-        
-        str += build_i_type_inst("or", target_reg, lv_reg, rv->get_val());
+/*
+ * set `len` words from `offset(addr_reg)` on to zero, opening a block for the
+ * loop and one after it, where the translation goes on
+ *
+ * @example  zero_loop_to_riscv(module, sp, 16, 20) =>
+ *      addi    t1, sp, 16
+ *      addi    t2, t1, 64
+ *  ZERO_0:
+ *      sw      zero, 0(t1)
+ *      ...
+ *      sw      zero, 28(t1)
+ *      addi    t1, t1, 32
+ *      bne     t1, t2, ZERO_0
+ *  ZERO_0_END:
+ *      sw      zero, 0(t1)
+ *      ...
+ *      sw      zero, 12(t1)
+ */
+static void zero_loop_to_riscv(
+    riscv_trans::MachineModule& module, 
+    riscv_trans::Register addr_reg, int offset, int len
+) {
+    using riscv_trans::MachineInstr, riscv_trans::MachineOperand, riscv_trans::Opcode;
+
+    int step { 4 * ZERO_LOOP_UNROLL };
+    int loop_size { len / ZERO_LOOP_UNROLL * step };
+    auto label { "ZERO_" + std::to_string(zero_loop_count++) };
+
+    auto ptr_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
+    auto end_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
+    auto& blocks { module.get_functions().back().get_blocks() };
+
+    auto& head { module.get_insert_block() };
+    if (riscv_trans::is_within_imm12_range(offset)) {
+        head += MachineInstr(Opcode::Addi, { ptr_reg, addr_reg, offset });
+    }
+    else {
+        head += MachineInstr(Opcode::Li, { ptr_reg, offset });
+        head += MachineInstr(Opcode::Add, { ptr_reg, ptr_reg, addr_reg });
+    }
+    if (riscv_trans::is_within_imm12_range(loop_size)) {
+        head += MachineInstr(Opcode::Addi, { end_reg, ptr_reg, loop_size });
+    }
+    else {
+        head += MachineInstr(Opcode::Li, { end_reg, loop_size });
+        head += MachineInstr(Opcode::Add, { end_reg, end_reg, ptr_reg });
+    }
 
-        riscv_trans::temp_reg_manager.refresh_reg(lv_reg);
+    auto& loop { blocks.emplace_back(label) };
+    for (int i { 0 }; i < ZERO_LOOP_UNROLL; i++) {
+        loop += MachineInstr(Opcode::Sw, { riscv_trans::Register("zero"), MachineOperand::mem(4 * i, ptr_reg) });
+    }
+    loop += MachineInstr(Opcode::Addi, { ptr_reg, ptr_reg, step });
+    loop += MachineInstr(Opcode::Bne, { ptr_reg, end_reg, label });
 
-        return target_reg;
+    // the words left over, right past where the loop stops
+    auto& tail { blocks.emplace_back(label + "_END") };
+    for (int i { 0 }; i < len % ZERO_LOOP_UNROLL; i++) {
+        tail += MachineInstr(Opcode::Sw, { riscv_trans::Register("zero"), MachineOperand::mem(4 * i, ptr_reg) });
     }
 
-    return expr_inst_builder("or", lv->value_to_riscv(str), rv->value_to_riscv(str), str);
+    riscv_trans::temp_reg_manager.refresh_reg(end_reg);
+    riscv_trans::temp_reg_manager.refresh_reg(ptr_reg);
 }
 
-riscv_trans::Register Xor::rvalue_to_riscv(std::string& str) const {
-    if (lv->is_const()) {
-        return Xor(rv, lv).rvalue_to_riscv(str);
+/*
+ * long runs of zeros are cleared by `zero_loop_to_riscv`, the other zeros by
+ * `sw zero`, and the non-zero elements by `li` and `sw`, the `li` left out
+ * for a value repeated
+ */
+void StoreInitializer::stmt_to_riscv(riscv_trans::MachineModule& module, riscv_trans::TransMode trans_mode) const {
+    module.get_insert_block() += build_comment(this);
+
+    auto flat_vec { initializer->to_flat_vec(addr->get_type()->unwrap()->get_byte_size()) };
+    int elem_n { static_cast<int>(flat_vec.size()) };
+
+    int offset;
+    auto addr_reg { riscv_trans::address_to_riscv(module.get_insert_block(), riscv_trans::get_address(addr), offset) };
+
+    auto zero_reg { riscv_trans::Register("zero") };
+    auto tmp_reg { riscv_trans::Register() };
+    bool is_tmp_loaded { false };
+    int tmp_val { 0 };
+
+    for (int i { 0 }; i < elem_n; ) {
+        int run_end { i };
+        while (run_end < elem_n && flat_vec[run_end] == 0) run_end++;
+
+        if (run_end - i >= ZERO_LOOP_MIN_RUN) {
+            // the loop takes two scratch registers
+            if (is_tmp_loaded) {
+                riscv_trans::temp_reg_manager.refresh_reg(tmp_reg);
+                is_tmp_loaded = false;
+            }
+
+            zero_loop_to_riscv(module, addr_reg, offset + 4 * i, run_end - i);
+            i = run_end;
+            continue;
+        }
+
+        auto& mbb { module.get_insert_block() };
+        for (; i < run_end; i++) {
+            mbb += build_sw_lw(riscv_trans::Opcode::Sw, zero_reg, offset + 4 * i, addr_reg);
+        }
+        if (i == elem_n) break;
+
+        if (!is_tmp_loaded || tmp_val != flat_vec[i]) {
+            if (!is_tmp_loaded) {
+                tmp_reg = riscv_trans::temp_reg_manager.get_unused_reg();
+                is_tmp_loaded = true;
+            }
+            tmp_val = flat_vec[i];
+            mbb += riscv_trans::MachineInstr(riscv_trans::Opcode::Li, { tmp_reg, tmp_val });
+        }
+        mbb += build_sw_lw(riscv_trans::Opcode::Sw, tmp_reg, offset + 4 * i, addr_reg);
+        i++;
     }
 
-    if (rv->is_const()) {
-        auto lv_reg { lv->value_to_riscv(str) };
+    if (is_tmp_loaded) {
+        riscv_trans::temp_reg_manager.refresh_reg(tmp_reg);
+    }
+    riscv_trans::temp_reg_manager.refresh_reg(addr_reg);
+}
 
-        auto target_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
-        
-        str += build_i_type_inst("xor", target_reg, lv_reg, rv->get_val());
+/*
+ * identifiers of comparisons whose only use is the branch right after them in
+ * the function currently at. The comparison is lowered by the branch itself
+ * into a single `b<cond>`, instead of being materialized as 0 or 1 and tested
+ * by `bnez`. Nothing is defined in between, so the operands still hold in the
+ * registers allocated to them when the branch reads them.
+ */
+static std::unordered_map<const Id*, const Rvalue*> fused_cmps;
 
-        riscv_trans::temp_reg_manager.refresh_reg(lv_reg);
+static void find_fused_cmps(const std::vector<Block*>& blocks) {
+    fused_cmps.clear();
 
-        return target_reg;
+    auto use_counts { std::unordered_map<const Id*, int>() };
+    for (auto* block: blocks) {
+        for (auto* stmt: block->get_stmts()) {
+            for (auto* id: stmt->get_used_ids()) {
+                use_counts[id]++;
+            }
+        }
     }
 
-    return expr_inst_builder("xor", lv->value_to_riscv(str), rv->value_to_riscv(str), str);
+    for (auto* block: blocks) {
+        auto& stmts { block->get_stmts() };
+        if (stmts.size() < 2) continue;
+
+        auto* branch { dynamic_cast<Branch*>(stmts.back()) };
+        auto* symbol_def { dynamic_cast<SymbolDef*>(stmts[stmts.size() - 2]) };
+        if (branch == nullptr || symbol_def == nullptr) continue;
+
+        auto* id { symbol_def->get_def_id() };
+        if (branch->get_cond() == id && use_counts[id] == 1 && symbol_def->get_val()->is_cmp()) {
+            fused_cmps[id] = symbol_def->get_val();
+        }
+    }
 }
 
+/*
+ * branches with Zbb on a comparison of `x` and `m` to a block doing nothing
+ * but `m = x` and rejoining, i.e. `if (x > m) m = x;` and the like, which
+ * put `max(x, m)` or `min(x, m)` into `m` and jump to the join block straight
+ * away instead. The assignment block is left out of the output unless
+ * another block jumps to it as well, see `get_bypassed_blocks`.
+ *
+ * in memory, `x` and `m` are the loads of their addresses the fused
+ * comparison reads, which still hold at the branch with nothing stored or
+ * called after them, and the result is stored to `addr`. In SSA form, the
+ * join block takes `m` from the branch and `x` from the assignment block,
+ * which only jumps, as its `arg_index`-th parameter, and the result goes
+ * there, `args` from the branch to the others. Those are found before
+ * `riscv_trans::split_arg_edges`, which leaves their edges alone, so the
+ * branch keeps its arguments and liveness takes it as defining the
+ * parameters of the join block, see `dataflow::get_def_ids`.
+ */
+struct MinMaxBranch {
+    riscv_trans::Opcode opcode;
+    Value* lv;
+    Value* rv;
+    Id* addr;
+    Label join;
+    std::vector<Id*> params;
+    std::vector<Value*> args;
+    int arg_index;
+};
+static std::unordered_map<const Branch*, MinMaxBranch> min_max_branches;
+
+/**
+ * @return  the comparison defining `cond` in `stmts`, nullptr if there is none
+ */
+static const Expr* get_cmp(const std::vector<Stmt*>& stmts, Value* cond) {
+    for (auto* stmt: stmts) {
+        auto* symbol_def { dynamic_cast<SymbolDef*>(stmt) };
+        if (symbol_def == nullptr || symbol_def->get_def_id() != cond) continue;
 
-riscv_trans::Register Shl::rvalue_to_riscv(std::string& str) const {
-    return expr_inst_builder("sll", lv->value_to_riscv(str), rv->value_to_riscv(str), str);
+        return symbol_def->get_val()->is_cmp() ? static_cast<const Expr*>(symbol_def->get_val()) : nullptr;
+    }
+    return nullptr;
 }
 
-riscv_trans::Register Shr::rvalue_to_riscv(std::string& str) const {
-    return expr_inst_builder("srl", lv->value_to_riscv(str), rv->value_to_riscv(str), str);
+static void find_min_max_arg_branches(const FuncDef* func_def) {
+    if (!riscv_trans::enable_zbb) return;
+
+    auto& cfg { dataflow::get_cfg(func_def) };
+    for (int i { 0 }; i < cfg.get_block_n(); i++) {
+        auto& stmts { cfg.get_block(i)->get_stmts() };
+        auto* branch { dynamic_cast<Branch*>(stmts.back()) };
+        if (branch == nullptr) continue;
+
+        // `lv > rv` is `max` of the two if `m = lv` is to be done
+        auto* cmp { get_cmp(stmts, branch->get_cond()) };
+        bool is_greater { dynamic_cast<const Gt*>(cmp) || dynamic_cast<const Ge*>(cmp) };
+        bool is_less { dynamic_cast<const Lt*>(cmp) || dynamic_cast<const Le*>(cmp) };
+        if (!is_greater && !is_less) continue;
+
+        int assign { cfg.get_succs(i)[0] }, join { cfg.get_succs(i)[1] };
+        auto* join_block { cfg.get_block(join) };
+        auto& assign_stmts { cfg.get_block(assign)->get_stmts() };
+        auto* jump { dynamic_cast<Jump*>(assign_stmts.back()) };
+        if (assign_stmts.size() != 1 || jump == nullptr || assign == join) continue;
+        if (cfg.get_succs(assign)[0] != join) continue;
+
+        auto args { branch->get_target_args(1) };
+        auto assign_args { jump->get_args() };
+        if (args.empty()) continue;
+
+        int arg_index { -1 };
+        for (int k { 0 }; k < args.size(); k++) {
+            if (args[k] == assign_args[k]) continue;
+            arg_index = arg_index == -1 ? k : -2;
+        }
+        if (arg_index < 0) continue;
+
+        auto* x { assign_args[arg_index] };
+        auto* m { args[arg_index] };
+
+        bool is_max;
+        if (cmp->get_lv() == x && cmp->get_rv() == m) is_max = is_greater;
+        else if (cmp->get_lv() == m && cmp->get_rv() == x) is_max = is_less;
+        else continue;
+
+        min_max_branches[branch] = {
+            is_max ? riscv_trans::Opcode::Max : riscv_trans::Opcode::Min,
+            cmp->get_lv(), cmp->get_rv(), nullptr, join_block->get_label(),
+            join_block->get_params(), args, arg_index
+        };
+    }
 }
 
-riscv_trans::Register Sar::rvalue_to_riscv(std::string& str) const {
-    return expr_inst_builder("sra", lv->value_to_riscv(str), rv->value_to_riscv(str), str);
+/**
+ * @return  address `val` is loaded from by a statement of `stmts`, nullptr if
+ *          it is not a load, together with the index of that statement
+ */
+static std::pair<Id*, int> get_load_addr(const std::vector<Stmt*>& stmts, Value* val) {
+    for (int i { 0 }; i < stmts.size(); i++) {
+        auto* symbol_def { dynamic_cast<SymbolDef*>(stmts[i]) };
+        if (symbol_def == nullptr || symbol_def->get_def_id() != val) continue;
+
+        auto* load { dynamic_cast<Load*>(symbol_def->get_val()) };
+        return { load ? load->get_addr() : nullptr, i };
+    }
+    return { nullptr, -1 };
 }
 
-void StoreValue::stmt_to_riscv(std::string& str, riscv_trans::TransMode trans_mode) const {
-    str += build_comment(this);
+static void find_min_max_branches(const std::vector<Block*>& blocks) {
+    if (!riscv_trans::enable_zbb) return;
 
-    auto addr_reg { riscv_trans::id_storage_map.get_storage(addr)->get(str) };
+    auto label_blocks { std::unordered_map<std::string, Block*>() };
+    for (auto* block: blocks) {
+        label_blocks[block->get_label().get_name()] = block;
+    }
 
-    auto val_reg { value->value_to_riscv(str) };
+    for (auto* block: blocks) {
+        auto& stmts { block->get_stmts() };
+        auto* branch { dynamic_cast<Branch*>(stmts.back()) };
+        if (branch == nullptr) continue;
+
+        auto cond_ids { branch->get_used_ids() };
+        if (cond_ids.size() != 1 || fused_cmps.count(cond_ids[0]) == 0) continue;
+
+        // `lv > rv` is `max` of the two if `m = lv` is to be done
+        auto* cmp { fused_cmps.at(cond_ids[0]) };
+        bool is_greater { dynamic_cast<const Gt*>(cmp) || dynamic_cast<const Ge*>(cmp) };
+        bool is_less { dynamic_cast<const Lt*>(cmp) || dynamic_cast<const Le*>(cmp) };
+        if (!is_greater && !is_less) continue;
+
+        auto targets { branch->get_target_labels() };
+        auto& assign_stmts { label_blocks.at(targets[0].get_name())->get_stmts() };
+        if (assign_stmts.size() != 3) continue;
+
+        auto* x_def { dynamic_cast<SymbolDef*>(assign_stmts[0]) };
+        auto* x_load { x_def ? dynamic_cast<Load*>(x_def->get_val()) : nullptr };
+        auto* store { dynamic_cast<StoreValue*>(assign_stmts[1]) };
+        auto* jump { dynamic_cast<Jump*>(assign_stmts[2]) };
+        if (x_load == nullptr || store == nullptr || jump == nullptr) continue;
+        if (store->get_used_ids() != std::vector<Id*> { x_def->get_def_id(), store->get_addr() }) continue;
+        if (jump->get_target_labels()[0].get_name() != targets[1].get_name()) continue;
+
+        auto* x_addr { x_load->get_addr() };
+        auto* m_addr { store->get_addr() };
+        if (x_addr == m_addr) continue;
+
+        auto* expr { static_cast<const Expr*>(cmp) };
+        auto [lv_addr, lv_index] { get_load_addr(stmts, expr->get_lv()) };
+        auto [rv_addr, rv_index] { get_load_addr(stmts, expr->get_rv()) };
+
+        bool is_max;
+        if (lv_addr == x_addr && rv_addr == m_addr) is_max = is_greater;
+        else if (lv_addr == m_addr && rv_addr == x_addr) is_max = is_less;
+        else continue;
+
+        bool is_clobbered { false };
+        for (int i { std::min(lv_index, rv_index) }; i < stmts.size(); i++) {
+            auto* symbol_def { dynamic_cast<SymbolDef*>(stmts[i]) };
+            if (symbol_def == nullptr ? stmts[i] != branch : stmts[i]->is_func_call()) {
+                is_clobbered = true;
+            }
+        }
+        if (is_clobbered) continue;
 
-    str += build_sw_lw("sw", val_reg, 0, addr_reg);
+        min_max_branches[branch] = {
+            is_max ? riscv_trans::Opcode::Max : riscv_trans::Opcode::Min,
+            expr->get_lv(), expr->get_rv(), m_addr, targets[1], {}, {}, -1
+        };
+    }
+}
 
-    riscv_trans::temp_reg_manager.refresh_reg(val_reg);
-    riscv_trans::temp_reg_manager.refresh_reg(addr_reg);
+/**
+ * @return  assignment blocks of the branches of `min_max_branches` in
+ *          `func_def` which nothing else jumps to, and so never run
+ */
+static std::unordered_set<const Block*> get_bypassed_blocks(const FuncDef* func_def) {
+    auto res { std::unordered_set<const Block*>() };
+
+    auto& cfg { dataflow::get_cfg(func_def) };
+    for (int i { 0 }; i < cfg.get_block_n(); i++) {
+        auto& stmts { cfg.get_block(i)->get_stmts() };
+        auto* branch { stmts.empty() ? nullptr : dynamic_cast<const Branch*>(stmts.back()) };
+        if (branch == nullptr || min_max_branches.count(branch) == 0) continue;
+
+        int assign { cfg.get_succs(i)[0] };
+        if (cfg.get_preds(assign).size() == 1) {
+            res.insert(cfg.get_block(assign));
+        }
+    }
+
+    return res;
 }
 
-void StoreInitializer::stmt_to_riscv(std::string& str, riscv_trans::TransMode trans_mode) const {
-    str += build_comment(this);
+/*
+ * `ret`s right after a call in `riscv_trans::current_tail_calls`, the call
+ * leaving the function by itself
+ */
+static std::unordered_set<const Return*> tail_call_returns;
 
-    auto flat_vec { initializer->to_flat_vec(addr->get_type()->unwrap()->get_byte_size()) };
+/*
+ * tail calls of the function currently at to itself, which reassign the
+ * parameters and jump back to the entry block labelled `entry_label`, as
+ * a loop, instead of entering the function anew
+ */
+static std::unordered_set<const FuncCall*> self_loop_calls;
+static std::string entry_label;
 
-    auto addr_reg { riscv_trans::id_storage_map.get_storage(addr)->get(str) };
-    auto tmp_reg { riscv_trans::temp_reg_manager.get_unused_reg() };
+/*
+ * find the calls whose result is returned right after them, or followed by
+ * a `ret` of nothing. Arguments beyond the eighth are stored into the area
+ * the function received its own ones in, so there must be no more of them
+ * than of its parameters, and they must not read the parameters being
+ * overwritten. A local array passed by pointer would go with the stack frame,
+ * so no pointer is passed in a tail call if the function has one.
+ */
+static void find_tail_calls(const FuncDef* func_def) {
+    riscv_trans::current_tail_calls.clear();
+    tail_call_returns.clear();
+    self_loop_calls.clear();
 
-    int offset { 0 };
-    for (auto item: flat_vec) {
-        str += build_inst("li", tmp_reg.get_lit(), std::to_string(item));
-        str += build_sw_lw("sw", tmp_reg, offset, addr_reg);
-        offset += 4;
+    if (!riscv_trans::enable_tail_call) return;
+
+    auto blocks { func_def->get_blocks() };
+    auto formal_param_ids { func_def->get_formal_param_ids() };
+
+    bool has_local_array { false };
+    for (auto* pseudo_id: riscv_trans::get_pseudo_ids(func_def)) {
+        has_local_array |= pseudo_id->get_type()->get_type_id() == Type::TypeId::Array;
     }
 
-    riscv_trans::temp_reg_manager.refresh_reg(tmp_reg);
-    riscv_trans::temp_reg_manager.refresh_reg(addr_reg);
+    // jumping back to an entry block with predecessors would skip the values live into it
+    auto entry_name { blocks.front()->get_label().get_name() };
+    bool is_entry_reentrant { true };
+    for (auto* block: blocks) {
+        for (auto* stmt: block->get_stmts()) {
+            for (auto& label: stmt->get_target_labels()) {
+                is_entry_reentrant &= label.get_name() != entry_name;
+            }
+        }
+    }
+    entry_label = to_riscv_style(entry_name);
+
+    for (auto* block: blocks) {
+        auto& stmts { block->get_stmts() };
+        if (stmts.size() < 2) continue;
+
+        auto* ret { dynamic_cast<Return*>(stmts.back()) };
+        auto* call_stmt { stmts[stmts.size() - 2] };
+        auto* func_call { riscv_trans::get_func_call(call_stmt) };
+        if (ret == nullptr || func_call == nullptr) continue;
+
+        auto* def_id { call_stmt->get_def_id() };
+        if (ret->get_val() != nullptr && (def_id == nullptr || ret->get_val() != def_id)) continue;
+
+        auto args { func_call->get_args() };
+
+        bool is_tail_call { true };
+        for (auto* arg: args) {
+            auto* arg_id { dynamic_cast<Id*>(arg) };
+            if (arg_id == nullptr) continue;
+
+            if (has_local_array && arg_id->get_type()->get_type_id() == Type::TypeId::Pointer) {
+                is_tail_call = false;
+            }
+            if (args.size() > 8 && std::find(formal_param_ids.begin(), formal_param_ids.end(), arg_id) != formal_param_ids.end()) {
+                is_tail_call = false;
+            }
+        }
+        if (args.size() > 8 && args.size() > formal_param_ids.size()) {
+            is_tail_call = false;
+        }
+        if (!is_tail_call) continue;
+
+        riscv_trans::current_tail_calls.insert(call_stmt);
+        tail_call_returns.insert(ret);
+
+        if (is_entry_reentrant && func_call->get_id()->get_lit() == func_def->get_id()->get_lit()) {
+            self_loop_calls.insert(func_call);
+        }
+    }
 }
 
-void SymbolDef::stmt_to_riscv(std::string& str, riscv_trans::TransMode trans_mode) const {
+static void tail_call_to_riscv(const FuncCall* self, riscv_trans::MachineBasicBlock& mbb);
 
-    str += build_comment(this);
+/*
+ * store the values `self` is to save into their slots before it, or load
+ * them back after it
+ *
+ * @param opcode  `sw` before the call, `lw` after it
+ */
+static void caller_saved_regs_to_riscv(
+    const FuncCall* self, 
+    riscv_trans::MachineBasicBlock& mbb, 
+    riscv_trans::Opcode opcode
+) {
+    auto saved_ids { riscv_trans::current_call_saved_ids.find(self) };
+    if (saved_ids == riscv_trans::current_call_saved_ids.end()) return;
+
+    for (auto* id: saved_ids->second) {
+        auto* reg { dynamic_cast<riscv_trans::Register*>(riscv_trans::id_storage_map.get_storage(id)) };
+        assert(reg != nullptr);
+        mbb += build_sw_lw(opcode, *reg, riscv_trans::current_save_slots.at(id));
+    }
+}
 
-    auto source_reg { val->rvalue_to_riscv(str) };
+void SymbolDef::stmt_to_riscv(riscv_trans::MachineModule& module, riscv_trans::TransMode trans_mode) const {
+    auto& mbb { module.get_insert_block() };
 
-    riscv_trans::id_storage_map.get_storage(id)->save(str, source_reg);
+    mbb += build_comment(this);
+
+    if (fused_cmps.count(id) || riscv_trans::current_folded_ids.count(id)) return;
+
+    if (riscv_trans::current_tail_calls.count(this)) {
+        tail_call_to_riscv(dynamic_cast<const FuncCall*>(val), mbb);
+        return;
+    }
+
+    auto source_reg { val->rvalue_to_riscv(mbb) };
+
+    riscv_trans::id_storage_map.get_storage(id)->save(mbb, source_reg);
 
     riscv_trans::temp_reg_manager.refresh_reg(source_reg);
-}
 
-void Return::stmt_to_riscv(std::string& str, riscv_trans::TransMode trans_mode) const {
+    // only now that the result is out of a0
+    if (auto* func_call { dynamic_cast<const FuncCall*>(val) }) {
+        caller_saved_regs_to_riscv(func_call, mbb, riscv_trans::Opcode::Lw);
+    }
+}
 
-    str += build_comment(this);
+/*
+ * save or restore the callee-saved registers of the current function, which
+ * are stored below ra at the top of the stack frame
+ *
+ * @param opcode  `sw` in the prologue, `lw` before returning
+ */
+static void callee_saved_regs_to_riscv(
+    riscv_trans::MachineBasicBlock& mbb, 
+    riscv_trans::Opcode opcode
+) {
+    int offset { riscv_trans::current_stack_frame_size };
+    if (riscv_trans::current_has_called_func) {
+        offset -= 4;
+    }
 
-    if (return_type == ReturnType::HasRetVal) {
-        auto ret_val_reg { val->value_to_riscv(str) };
-        str += build_inst("mv", "a0", ret_val_reg.get_lit());
-        riscv_trans::temp_reg_manager.refresh_reg(ret_val_reg);
+    for (auto reg: riscv_trans::current_saved_regs) {
+        offset -= 4;
+        mbb += build_sw_lw(opcode, reg, offset);
     }
+}
+
+/*
+ * restore ra and the callee-saved registers, and pop the stack frame
+ */
+static void epilogue_to_riscv(riscv_trans::MachineBasicBlock& mbb) {
+    callee_saved_regs_to_riscv(mbb, riscv_trans::Opcode::Lw);
 
     if (riscv_trans::current_has_called_func) {
-        str += build_sw_lw(
-            "lw", riscv_trans::Register("ra"), 
+        mbb += build_sw_lw(
+            riscv_trans::Opcode::Lw, riscv_trans::Register("ra"), 
             riscv_trans::current_stack_frame_size - 4
         );
     }
 
     if (riscv_trans::current_stack_frame_size != 0) {
-        str += build_i_type_inst(
-            "add", 
+        mbb += build_i_type_inst(
+            riscv_trans::Opcode::Add, 
             riscv_trans::Register("sp"), 
             riscv_trans::Register("sp"), 
             riscv_trans::current_stack_frame_size
         );
     }
+}
+
+void Return::stmt_to_riscv(riscv_trans::MachineModule& module, riscv_trans::TransMode trans_mode) const {
+    auto& mbb { module.get_insert_block() };
 
-    str += build_inst("ret");
+    mbb += build_comment(this);
+
+    if (tail_call_returns.count(this)) return;
+
+    if (return_type == ReturnType::HasRetVal) {
+        auto ret_val_reg { val->value_to_riscv(mbb) };
+        riscv_trans::Register("a0").save(mbb, ret_val_reg);
+        riscv_trans::temp_reg_manager.refresh_reg(ret_val_reg);
+    }
+
+    epilogue_to_riscv(mbb);
+
+    mbb += riscv_trans::MachineInstr(riscv_trans::Opcode::Ret);
 }
 
-void Branch::stmt_to_riscv(std::string& str, riscv_trans::TransMode trans_mode) const {
-    auto cond_reg { cond->value_to_riscv(str) };
-    str += build_inst("bnez", cond_reg.get_lit(), to_riscv_style(target1.get_name()));
-    str += build_inst("j", to_riscv_style(target2.get_name()));
+static void parallel_copy_to_riscv(
+    riscv_trans::MachineBasicBlock& mbb,
+    const std::vector<riscv_trans::RiscvStorage*>& dsts,
+    const std::vector<Value*>& srcs
+);
+
+void Branch::stmt_to_riscv(riscv_trans::MachineModule& module, riscv_trans::TransMode trans_mode) const {
+    auto& mbb { module.get_insert_block() };
+
+    auto min_max_it { min_max_branches.find(this) };
+    if (min_max_it != min_max_branches.end()) {
+        auto& min_max { min_max_it->second };
+
+        auto lv_reg { min_max.lv->value_to_riscv(mbb) };
+        auto rv_reg { min_max.rv->value_to_riscv(mbb) };
+        auto res_reg {
+            riscv_trans::temp_reg_manager.is_temp_reg(lv_reg) ? lv_reg
+                : riscv_trans::temp_reg_manager.is_temp_reg(rv_reg) ? rv_reg
+                : riscv_trans::temp_reg_manager.get_unused_reg()
+        };
+        mbb += riscv_trans::MachineInstr(min_max.opcode, { res_reg, lv_reg, rv_reg });
+        if (res_reg.get_serial_num() != lv_reg.get_serial_num()) riscv_trans::temp_reg_manager.refresh_reg(lv_reg);
+        if (res_reg.get_serial_num() != rv_reg.get_serial_num()) riscv_trans::temp_reg_manager.refresh_reg(rv_reg);
+
+        if (min_max.addr != nullptr) {
+            int offset;
+            auto addr_reg { riscv_trans::address_to_riscv(mbb, riscv_trans::get_address(min_max.addr), offset) };
+            mbb += build_sw_lw(riscv_trans::Opcode::Sw, res_reg, offset, addr_reg);
+            riscv_trans::temp_reg_manager.refresh_reg(addr_reg);
+        }
+        else {
+            // the other parameters first, which may be where `x` or `m` was
+            auto param_storages { std::vector<riscv_trans::RiscvStorage*>() };
+            auto args { std::vector<Value*>() };
+            for (int k { 0 }; k < min_max.params.size(); k++) {
+                if (k == min_max.arg_index) continue;
+                param_storages.push_back(riscv_trans::id_storage_map.get_storage(min_max.params[k]));
+                args.push_back(min_max.args[k]);
+            }
+            parallel_copy_to_riscv(mbb, param_storages, args);
+
+            riscv_trans::id_storage_map.get_storage(min_max.params[min_max.arg_index])->save(mbb, res_reg);
+        }
+        riscv_trans::temp_reg_manager.refresh_reg(res_reg);
+
+        mbb += riscv_trans::MachineInstr(riscv_trans::Opcode::J, { to_riscv_style(min_max.join.get_name()) });
+        return;
+    }
+
+    auto fused_cmp_it { fused_cmps.find(dynamic_cast<Id*>(cond)) };
+    if (fused_cmp_it != fused_cmps.end()) {
+        fused_cmp_it->second->cmp_branch_to_riscv(mbb, to_riscv_style(target1.get_name()));
+        mbb += riscv_trans::MachineInstr(riscv_trans::Opcode::J, { to_riscv_style(target2.get_name()) });
+        return;
+    }
+
+    auto cond_reg { cond->value_to_riscv(mbb) };
+    mbb += riscv_trans::MachineInstr(riscv_trans::Opcode::Bnez, { cond_reg, to_riscv_style(target1.get_name()) });
+    mbb += riscv_trans::MachineInstr(riscv_trans::Opcode::J, { to_riscv_style(target2.get_name()) });
 
     riscv_trans::temp_reg_manager.refresh_reg(cond_reg);
 }
 
-void Jump::stmt_to_riscv(std::string& str, riscv_trans::TransMode trans_mode) const {
-    str += build_inst("j", to_riscv_style(target.get_name()));
+/*
+ * `val` in `target_reg`, loaded or put there directly if it is a constant or
+ * on the stack frame instead of through a scratch register
+ */
+static void value_to_reg(Value* val, riscv_trans::Register target_reg, riscv_trans::MachineBasicBlock& mbb) {
+    if (val->is_const()) {
+        mbb += riscv_trans::MachineInstr(riscv_trans::Opcode::Li, { target_reg, val->get_val() });
+        return;
+    }
+
+    auto* id { dynamic_cast<Id*>(val) };
+    if (id != nullptr) {
+        auto* stack_frame { dynamic_cast<riscv_trans::StackFrame*>(riscv_trans::id_storage_map.get_storage(id)) };
+        if (stack_frame != nullptr) {
+            mbb += build_sw_lw(riscv_trans::Opcode::Lw, target_reg, stack_frame->get_offset());
+            return;
+        }
+    }
+
+    auto source_reg { val->value_to_riscv(mbb) };
+    target_reg.save(mbb, source_reg);
+    riscv_trans::temp_reg_manager.refresh_reg(source_reg);
 }
 
-static void func_call_to_riscv_impl(const koopa::FuncCall* self, std::string& str) {
-    // no need to save registers since all identifiers so far have been stored on the stack frame
+/*
+ * register or stack frame slot a storage location names, the same string for
+ * the same one
+ */
+static std::string get_location_key(riscv_trans::RiscvStorage* storage) {
+    auto* stack_frame { dynamic_cast<riscv_trans::StackFrame*>(storage) };
+    if (stack_frame != nullptr) {
+        return std::to_string(stack_frame->get_offset()) + "(sp)";
+    }
+    return storage->get_lit();
+}
 
-    auto self_args { self->get_args() };
-    for (int i { 0 }; i < self_args.size(); i++) {
-        auto arg_reg { self_args[i]->value_to_riscv(str) };
-
-        if (i < 8) {
-            str += build_inst(
-                "mv",
-                'a' + std::to_string(i),
-                arg_reg.get_lit()
-            );
+/*
+ * `dsts[i] = srcs[i]` for every `i` at once, see `out_of_ssa.h`. Constants
+ * are put into their destinations last, after those have been read
+ */
+static void parallel_copy_to_riscv(
+    riscv_trans::MachineBasicBlock& mbb,
+    const std::vector<riscv_trans::RiscvStorage*>& dsts,
+    const std::vector<Value*>& srcs
+) {
+    // numbered by `get_location_key`, 0 being the scratch register
+    auto scratch { riscv_trans::temp_reg_manager.get_unused_reg() };
+    auto locations { std::vector<riscv_trans::RiscvStorage*> { &scratch } };
+    auto location_numbers { std::unordered_map<std::string, int> { { get_location_key(&scratch), 0 } } };
+    auto get_location_number = [&](riscv_trans::RiscvStorage* storage) {
+        auto [it, is_new] { location_numbers.emplace(get_location_key(storage), locations.size()) };
+        if (is_new) locations.push_back(storage);
+        return it->second;
+    };
+
+    auto copies { std::vector<riscv_trans::Copy>() };
+    auto const_copies { std::vector<std::pair<riscv_trans::RiscvStorage*, Value*>>() };
+    for (int i { 0 }; i < dsts.size(); i++) {
+        auto* src_id { dynamic_cast<Id*>(srcs[i]) };
+        if (src_id == nullptr) {
+            const_copies.push_back({ dsts[i], srcs[i] });
+            continue;
         }
-        else {
-            str += build_sw_lw("sw", arg_reg, 4 * (i - 8));
+        copies.push_back({
+            get_location_number(dsts[i]),
+            get_location_number(riscv_trans::id_storage_map.get_storage(src_id))
+        });
+    }
+
+    for (auto [dst, src]: riscv_trans::sequentialize_copies(copies, 0)) {
+        auto* dst_reg { dynamic_cast<riscv_trans::Register*>(locations[dst]) };
+        auto* src_stack_frame { dynamic_cast<riscv_trans::StackFrame*>(locations[src]) };
+        if (dst_reg != nullptr && src_stack_frame != nullptr) {
+            mbb += build_sw_lw(riscv_trans::Opcode::Lw, *dst_reg, src_stack_frame->get_offset());
+            continue;
+        }
+
+        auto src_reg { locations[src]->get(mbb) };
+        locations[dst]->save(mbb, src_reg);
+        riscv_trans::temp_reg_manager.refresh_reg(src_reg);
+    }
+
+    riscv_trans::temp_reg_manager.refresh_reg(scratch);
+
+    for (auto [dst, val]: const_copies) {
+        auto* dst_reg { dynamic_cast<riscv_trans::Register*>(dst) };
+        if (dst_reg != nullptr) {
+            value_to_reg(val, *dst_reg, mbb);
+            continue;
+        }
+
+        auto val_reg { val->get_val() == 0 ? riscv_trans::Register("zero") : val->value_to_riscv(mbb) };
+        dst->save(mbb, val_reg);
+        riscv_trans::temp_reg_manager.refresh_reg(val_reg);
+    }
+}
+
+/*
+ * `jump`s to a block with parameters in the function currently at, to those
+ * parameters, which the `jump` copies its arguments into
+ */
+static std::unordered_map<const Jump*, std::vector<Id*>> jump_params;
+
+static void find_jump_params(const FuncDef* func_def) {
+    jump_params.clear();
+
+    auto& cfg { dataflow::get_cfg(func_def) };
+    for (int i { 0 }; i < cfg.get_block_n(); i++) {
+        auto& stmts { cfg.get_block(i)->get_stmts() };
+        auto* jump { stmts.empty() ? nullptr : dynamic_cast<Jump*>(stmts.back()) };
+        if (jump != nullptr && !jump->get_args().empty()) {
+            jump_params[jump] = cfg.get_block(cfg.get_succs(i)[0])->get_params();
         }
+    }
+}
 
+void Jump::stmt_to_riscv(riscv_trans::MachineModule& module, riscv_trans::TransMode trans_mode) const {
+    auto& mbb { module.get_insert_block() };
+
+    auto params { jump_params.find(this) };
+    if (params != jump_params.end()) {
+        auto param_storages { std::vector<riscv_trans::RiscvStorage*>() };
+        for (auto* param: params->second) {
+            param_storages.push_back(riscv_trans::id_storage_map.get_storage(param));
+        }
+        parallel_copy_to_riscv(mbb, param_storages, args);
+    }
+
+    mbb += riscv_trans::MachineInstr(riscv_trans::Opcode::J, { to_riscv_style(target.get_name()) });
+}
+
+/*
+ * move the arguments of `self` beyond the eighth onto the stack from
+ * `stack_arg_offset(sp)` on, then the first eight into a0-a7 all at once, as
+ * a parameter of the function may be in one of them and passed in another
+ */
+static void args_to_riscv(const koopa::FuncCall* self, riscv_trans::MachineBasicBlock& mbb, int stack_arg_offset) {
+    auto self_args { self->get_args() };
+    for (int i { 8 }; i < self_args.size(); i++) {
+        auto arg_reg { 
+            self_args[i]->is_const() && self_args[i]->get_val() == 0 
+                ? riscv_trans::Register("zero") : self_args[i]->value_to_riscv(mbb)
+        };
+        mbb += build_sw_lw(riscv_trans::Opcode::Sw, arg_reg, stack_arg_offset + 4 * (i - 8));
         riscv_trans::temp_reg_manager.refresh_reg(arg_reg);
     }
 
-    str += build_inst(
-        "call", to_riscv_style(self->get_id()->get_lit())
+    int reg_arg_n { std::min(static_cast<int>(self_args.size()), 8) };
+    auto arg_regs { std::vector<riscv_trans::Register>() };
+    for (int i { 0 }; i < reg_arg_n; i++) {
+        arg_regs.push_back(riscv_trans::Register('a' + std::to_string(i)));
+    }
+
+    auto arg_storages { std::vector<riscv_trans::RiscvStorage*>() };
+    for (auto& arg_reg: arg_regs) {
+        arg_storages.push_back(&arg_reg);
+    }
+    parallel_copy_to_riscv(mbb, arg_storages, { self_args.begin(), self_args.begin() + reg_arg_n });
+}
+
+/*
+ * only the values the register allocator left in caller-saved registers while
+ * live across the call are saved around it, see `current_call_saved_ids`
+ */
+static void func_call_to_riscv_impl(const koopa::FuncCall* self, riscv_trans::MachineBasicBlock& mbb) {
+    caller_saved_regs_to_riscv(self, mbb, riscv_trans::Opcode::Sw);
+
+    args_to_riscv(self, mbb, 0);
+
+    mbb += riscv_trans::MachineInstr(
+        riscv_trans::Opcode::Call, { to_riscv_style(self->get_id()->get_lit()) }
     );
 }
 
-riscv_trans::Register FuncCall::rvalue_to_riscv(std::string& str) const {
-    func_call_to_riscv_impl(this, str);
+/*
+ * the arguments beyond the eighth overwrite the ones the function received,
+ * right above its stack frame, before the frame is torn down and the callee
+ * entered by `tail`, returning to the caller of the function directly
+ */
+static void tail_call_to_riscv(const koopa::FuncCall* self, riscv_trans::MachineBasicBlock& mbb) {
+    args_to_riscv(self, mbb, riscv_trans::current_stack_frame_size);
+
+    if (self_loop_calls.count(self)) {
+        mbb += riscv_trans::MachineInstr(riscv_trans::Opcode::J, { entry_label });
+        return;
+    }
+
+    epilogue_to_riscv(mbb);
+
+    mbb += riscv_trans::MachineInstr(
+        riscv_trans::Opcode::Tail, { to_riscv_style(self->get_id()->get_lit()) }
+    );
+}
+
+riscv_trans::Register FuncCall::rvalue_to_riscv(riscv_trans::MachineBasicBlock& mbb) const {
+    func_call_to_riscv_impl(this, mbb);
 
     return riscv_trans::Register("a0");
 }
 
-void FuncCall::stmt_to_riscv(std::string& str, riscv_trans::TransMode trans_mode) const {
-    str += build_comment(static_cast<const koopa::Stmt*>(this));
+void FuncCall::stmt_to_riscv(riscv_trans::MachineModule& module, riscv_trans::TransMode trans_mode) const {
+    auto& mbb { module.get_insert_block() };
+
+    mbb += build_comment(static_cast<const koopa::Stmt*>(this));
+
+    if (riscv_trans::current_tail_calls.count(this)) {
+        tail_call_to_riscv(this, mbb);
+        return;
+    }
+
+    func_call_to_riscv_impl(this, mbb);
 
-    func_call_to_riscv_impl(this, str);
+    caller_saved_regs_to_riscv(this, mbb, riscv_trans::Opcode::Lw);
 }
 
-void Block::block_to_riscv(std::string& str) const {
-    str += to_riscv_style(label.get_name()) + ":\n";
+void Block::block_to_riscv(riscv_trans::MachineModule& module) const {
+    module.get_functions().back().get_blocks().emplace_back(to_riscv_style(label.get_name()));
     for(auto* stmt: stmts) {
-        stmt->stmt_to_riscv(str, riscv_trans::TransMode::TextSegment);
+        stmt->stmt_to_riscv(module, riscv_trans::TransMode::TextSegment);
     }
 }
 
@@ -407,20 +1225,29 @@ void Block::block_to_riscv(std::string& str) const {
  * the remaining parameters are placed on the stack frame, in order 
  * 0(sp), 4(sp), 8(sp)...
  */
-void FuncDef::stmt_to_riscv(std::string& str, riscv_trans::TransMode trans_mode) const {
+void FuncDef::stmt_to_riscv(riscv_trans::MachineModule& module, riscv_trans::TransMode trans_mode) const {
     if (trans_mode == riscv_trans::TransMode::TextSegment) {
-
-        str += build_comment(this->id);
         
         value_manager.enter_func(id->get_lit());
 
+        riscv_trans::lower_addresses(this);
+
+        find_tail_calls(this);
+
+        find_jump_params(this);
+
         riscv_trans::allocate_ids_storage_location(this);
 
-        str += to_riscv_style(id->get_lit()) + ":\n";
+        auto& func { module.get_functions().emplace_back(to_riscv_style(id->get_lit())) };
+
+        // the prologue, labelled with the function name
+        auto& mbb { func.get_blocks().emplace_back(to_riscv_style(id->get_lit())) };
+
+        mbb += build_comment(this->id);
 
         if (riscv_trans::current_stack_frame_size != 0) {
-            str += build_i_type_inst(
-                "add", 
+            mbb += build_i_type_inst(
+                riscv_trans::Opcode::Add, 
                 riscv_trans::Register("sp"), 
                 riscv_trans::Register("sp"), 
                 -riscv_trans::current_stack_frame_size
@@ -428,38 +1255,75 @@ void FuncDef::stmt_to_riscv(std::string& str, riscv_trans::TransMode trans_mode)
         }
 
         if (riscv_trans::current_has_called_func) {
-            str += build_sw_lw(
-                "sw", riscv_trans::Register("ra"), 
+            mbb += build_sw_lw(
+                riscv_trans::Opcode::Sw, riscv_trans::Register("ra"), 
                 riscv_trans::current_stack_frame_size - 4
             );
         }
 
+        callee_saved_regs_to_riscv(mbb, riscv_trans::Opcode::Sw);
+
+        if (riscv_trans::current_anchor_offset != 0) {
+            mbb += build_i_type_inst(
+                riscv_trans::Opcode::Add, 
+                riscv_trans::Register("fp"), 
+                riscv_trans::Register("sp"), 
+                riscv_trans::current_anchor_offset
+            );
+        }
+
+        find_fused_cmps(blocks);
+        find_min_max_branches(blocks);
+
+        auto bypassed_blocks { get_bypassed_blocks(this) };
         for (auto* block: blocks) {
-            block->block_to_riscv(str);
+            if (bypassed_blocks.count(block) == 0) {
+                block->block_to_riscv(module);
+            }
         }
 
         value_manager.leave_func();
     }
 }
 
-void GlobalSymbolDef::stmt_to_riscv(std::string& str, riscv_trans::TransMode trans_mode) const {
+void GlobalSymbolDef::stmt_to_riscv(riscv_trans::MachineModule& module, riscv_trans::TransMode trans_mode) const {
     if (trans_mode == riscv_trans::TransMode::DataSegment) {
         riscv_trans::id_storage_map.register_id(
             id, 
             new riscv_trans::DataSeg(to_riscv_style(id->get_lit()))
         );
 
-        str += build_comment(this);
+        auto comment { debug_mode_riscv ? to_string() : "" };
+        comment.erase(std::remove(comment.begin(), comment.end(), '\n'), comment.end());
+
+        module.get_globals().emplace_back(to_riscv_style(id->get_lit()), comment);
 
-        str += "\t.global " + to_riscv_style(id->get_lit()) + '\n';
-        str += to_riscv_style(id->get_lit()) + ":\n";
-        decl->stmt_to_riscv(str, trans_mode);
+        decl->stmt_to_riscv(module, trans_mode);
     }
 }
 
-void GlobalMemoryDecl::stmt_to_riscv(std::string& str, riscv_trans::TransMode trans_mode) const {
+/*
+ * arrays of at least a cache line start on one
+ */
+static constexpr int CACHE_LINE_SIZE = 64;
+static constexpr int CACHE_LINE_ALIGN = 6;
+
+void GlobalMemoryDecl::stmt_to_riscv(riscv_trans::MachineModule& module, riscv_trans::TransMode trans_mode) const {
+    using Directive = riscv_trans::MachineGlobal::Directive;
+    using Section = riscv_trans::MachineGlobal::Section;
+
+    auto& global { module.get_globals().back() };
+    auto& directives { global.get_directives() };
+
     auto flat_vec { initializer->to_flat_vec(type->get_byte_size()) };
 
+    bool is_all_zero { std::all_of(flat_vec.begin(), flat_vec.end(), [](int item) { return item == 0; }) };
+    global.set_section(is_read_only() ? Section::Rodata : is_all_zero ? Section::Bss : Section::Data);
+
+    if (type->get_byte_size() >= CACHE_LINE_SIZE) {
+        global.set_align(CACHE_LINE_ALIGN);
+    }
+
     int zero_count { 0 };
     for (auto item: flat_vec) {
         if (item == 0) { 
@@ -468,34 +1332,111 @@ void GlobalMemoryDecl::stmt_to_riscv(std::string& str, riscv_trans::TransMode tr
         }
 
         if (zero_count > 0) {
-            str += "\t.zero " + std::to_string(zero_count * 4) + "\n";
+            directives.push_back({ Directive::Kind::Zero, zero_count * 4 });
+            zero_count = 0;
         }
 
-        str += "\t.word " + std::to_string(item) + "\n";
+        directives.push_back({ Directive::Kind::Word, item });
     }
 
     if (zero_count > 0) {
-        str += "\t.zero " + std::to_string(zero_count * 4) + "\n";
+        directives.push_back({ Directive::Kind::Zero, zero_count * 4 });
     }
 }
 
-void FuncDecl::stmt_to_riscv(std::string& str, riscv_trans::TransMode trans_mode) const {
+void FuncDecl::stmt_to_riscv(riscv_trans::MachineModule& module, riscv_trans::TransMode trans_mode) const {
 }
 
+/*
+ * order the globals by their first access, going through the functions in
+ * the order they are defined, so that those accessed by the same function
+ * lie next to each other and share cache lines. Globals never accessed go
+ * last.
+ */
+static void order_globals_by_access(
+    std::vector<riscv_trans::MachineGlobal>& globals,
+    const std::vector<GlobalStmt*>& global_stmts
+) {
+    auto ranks { std::unordered_map<std::string, int>() };
+    for (auto& global: globals) {
+        ranks[global.get_name()] = INT32_MAX;
+    }
+
+    int rank { 0 };
+    for (auto* global_stmt: global_stmts) {
+        auto* func_def { dynamic_cast<FuncDef*>(global_stmt) };
+        if (func_def == nullptr) continue;
+
+        for (auto* block: func_def->get_blocks()) {
+            for (auto* stmt: block->get_stmts()) {
+                for (auto* id: stmt->get_used_ids()) {
+                    if (id->get_lit()[0] != '@') continue;
+
+                    auto it { ranks.find(to_riscv_style(id->get_lit())) };
+                    if (it != ranks.end() && it->second == INT32_MAX) {
+                        it->second = rank++;
+                    }
+                }
+            }
+        }
+    }
+
+    std::stable_sort(globals.begin(), globals.end(), [&](auto& a, auto& b) {
+        return ranks.at(a.get_name()) < ranks.at(b.get_name());
+    });
+}
+
+/*
+ * lower the program into `riscv_trans::MachineModule`, lay out the blocks,
+ * clean it up with the peephole optimizer and print it at once
+ */
 void Program::prog_to_riscv(std::string& str) const {
-    str += "\t.data\n";
+    riscv_trans::MachineModule module;
+
     for (auto* global_stmt: global_stmts) {
-        global_stmt->stmt_to_riscv(str, riscv_trans::TransMode::DataSegment);
+        global_stmt->stmt_to_riscv(module, riscv_trans::TransMode::DataSegment);
     }
 
+    order_globals_by_access(module.get_globals(), global_stmts);
+
+    min_max_branches.clear();
+    for (auto* global_stmt: global_stmts) {
+        auto* func_def { dynamic_cast<FuncDef*>(global_stmt) };
+        if (func_def != nullptr) {
+            find_min_max_arg_branches(func_def);
+            riscv_trans::split_arg_edges(func_def, [](const Branch* branch) {
+                return min_max_branches.count(branch) != 0;
+            });
+        }
+    }
 
-    str += "\t.text\n";
-    str += "\t.global main\n";
     for (auto* global_stmt: global_stmts) {
-        global_stmt->stmt_to_riscv(str, riscv_trans::TransMode::TextSegment);
+        global_stmt->stmt_to_riscv(module, riscv_trans::TransMode::TextSegment);
+    }
+
+    if (riscv_trans::enable_block_layout) {
+        for (auto& func: module.get_functions()) {
+            riscv_trans::layout_blocks(func);
+        }
+    }
+
+    if (riscv_trans::enable_peephole) {
+        for (auto& func: module.get_functions()) {
+            riscv_trans::run_peephole(func);
+        }
+
+        if (debug_mode_peephole) {
+            riscv_trans::report_peephole_counts();
+        }
     }
 
-    
+    if (riscv_trans::enable_rvc) {
+        for (auto& func: module.get_functions()) {
+            riscv_trans::compress_function(func);
+        }
+    }
+
+    module.print(str);
 }
 
-}
\ No newline at end of file
+}
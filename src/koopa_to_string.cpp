@@ -161,13 +161,32 @@ std::string StoreInitializer::to_string() const {
     return "store " + initializer->to_string() + ", " + addr->to_string();
 }
 
+/*
+ * `target(arg, ...)`, or `target` alone if there is no argument
+ */
+static std::string target_to_string(const Label& target, const std::vector<Value*>& args) {
+    auto res { target.get_name() };
+
+    if (args.size() > 0) {
+        res += '(';
+        for (auto* arg: args) {
+            res += arg->to_string() + ", ";
+        }
+        res.pop_back(); // ` `
+        res.pop_back(); // `,`
+        res += ')';
+    }
+
+    return res;
+}
+
 std::string Branch::to_string() const {
     return "br " + cond->to_string() + ", " 
-        + target1.get_name() + ", " + target2.get_name();
+        + target_to_string(target1, args1) + ", " + target_to_string(target2, args2);
 }
 
 std::string Jump::to_string() const {
-    return "jump " + target.get_name();
+    return "jump " + target_to_string(target, args);
 }
 
 std::string Return::to_string() const {
@@ -177,7 +196,17 @@ std::string Return::to_string() const {
 std::string Block::to_string() const {
     auto res { std::string("") };
 
-    res += label.get_name() + ":\n";
+    res += label.get_name();
+    if (params.size() > 0) {
+        res += '(';
+        for (auto* param: params) {
+            res += param->get_lit() + ": " + param->get_type()->to_string() + ", ";
+        }
+        res.pop_back(); // ` `
+        res.pop_back(); // `,`
+        res += ')';
+    }
+    res += ":\n";
     for (auto* stmt: stmts) {
         res += '\t' + stmt->to_string() + '\n';
     }
@@ -0,0 +1,247 @@
+#include "allocate.h"
+#include "cfg.h"
+#include "riscv_trans.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+namespace riscv_trans {
+
+/*
+ * registers handed out by the allocator, in order of preference. t0-t2 are
+ * kept for `TempRegManager`, a0-a7 are tried from the top down since the low
+ * ones are taken by parameters and return values first.
+ *
+ * s1-s11 survive calls but cost a save and a restore in the prologue and the
+ * epilogue, so they are the first choice for intervals crossing a call and the
+ * last one for the others. Past them, an interval crossing fewer calls than
+ * half its references takes t3-t6, saved and restored around each call,
+ * rather than being spilled.
+ */
+static const char* temp_regs[] { "t3", "t4", "t5", "t6" };
+static const char* arg_regs[] { "a7", "a6", "a5", "a4", "a3", "a2", "a1", "a0" };
+static const char* saved_regs[] {
+    "s1", "s2", "s3", "s4", "s5", "s6", "s7", "s8", "s9", "s10", "s11"
+};
+
+static std::vector<int> get_candidate_regs(const LiveInterval& interval) {
+    auto res { std::vector<int>() };
+
+    if (!interval.crosses_call) {
+        for (auto* reg: temp_regs) {
+            res.push_back(Register(reg).get_serial_num());
+        }
+
+        // argument setup overwrites a0-a7
+        for (int i { 0 }; !interval.covers_call && i < 8; i++) {
+            res.push_back(Register(arg_regs[i]).get_serial_num());
+        }
+    }
+
+    for (auto* reg: saved_regs) {
+        res.push_back(Register(reg).get_serial_num());
+    }
+
+    if (interval.crosses_call && 2 * interval.crossed_call_n < interval.ref_n) {
+        for (auto* reg: temp_regs) {
+            res.push_back(Register(reg).get_serial_num());
+        }
+    }
+
+    // x8-x15 have the most compressed forms, s1 already comes first of s1-s11
+    if (enable_rvc && !interval.crosses_call) {
+        std::stable_partition(res.begin(), res.end(), [](int reg) {
+            return Register(reg).is_compressible() && !Register(reg).is_callee_saved();
+        });
+    }
+
+    return res;
+}
+
+/**
+ * @return  for each block parameter the identifiers passed to it, and for
+ *          each of those the parameters it is passed to
+ */
+static std::unordered_map<koopa::Id*, std::vector<koopa::Id*>> get_copy_partners(const koopa::FuncDef* func_def) {
+    auto res { std::unordered_map<koopa::Id*, std::vector<koopa::Id*>>() };
+
+    auto& cfg { dataflow::get_cfg(func_def) };
+    for (int i { 0 }; i < cfg.get_block_n(); i++) {
+        auto& stmts { cfg.get_block(i)->get_stmts() };
+        auto* jump { stmts.empty() ? nullptr : dynamic_cast<koopa::Jump*>(stmts.back()) };
+        if (jump == nullptr) continue;
+
+        auto& params { cfg.get_block(cfg.get_succs(i)[0])->get_params() };
+        auto args { jump->get_args() };
+        for (int j { 0 }; j < args.size(); j++) {
+            if (auto* arg_id { dynamic_cast<koopa::Id*>(args[j]) }) {
+                res[params[j]].push_back(arg_id);
+                res[arg_id].push_back(params[j]);
+            }
+        }
+    }
+
+    return res;
+}
+
+struct ActiveInterval {
+    const LiveInterval* interval;
+    int reg;
+    bool is_fixed;  // formal parameter arriving in its register
+};
+
+std::vector<koopa::Id*> linear_scan_allocate(const koopa::FuncDef* func_def) {
+    auto candidates { std::vector<koopa::Id*>() };
+    for (auto* id: get_value_ids(func_def)) {
+        if (current_folded_ids.count(id) == 0) {
+            candidates.push_back(id);
+        }
+    }
+
+    /*
+     * the first eight parameters are precolored to a0-a7, see
+     * `allocate_ids_storage_location`
+     */
+    std::unordered_map<koopa::Id*, int> param_regs;
+    auto formal_param_ids { func_def->get_formal_param_ids() };
+    for (int i { 0 }; i < formal_param_ids.size() && i < 8; i++) {
+        param_regs.emplace(
+            formal_param_ids[i],
+            Register("a" + std::to_string(i)).get_serial_num()
+        );
+        candidates.push_back(formal_param_ids[i]);
+    }
+
+    auto intervals { build_live_intervals(func_def, candidates) };
+    auto copy_partners { get_copy_partners(func_def) };
+
+    bool is_reg_free[REG_COUNT];
+    for (int i { 0 }; i < REG_COUNT; i++) {
+        is_reg_free[i] = true;
+    }
+
+    auto active { std::vector<ActiveInterval>() };
+    std::unordered_map<koopa::Id*, int> assigned_regs;
+    auto stack_ids { get_pseudo_ids(func_def) };
+
+    for (auto& interval: intervals) {
+        // expire intervals ending before the current one starts
+        for (auto it { active.begin() }; it != active.end(); ) {
+            if (it->interval->end < interval.start) {
+                is_reg_free[it->reg] = true;
+                it = active.erase(it);
+            }
+            else {
+                it++;
+            }
+        }
+
+        auto param_reg { param_regs.find(interval.id) };
+        if (param_reg != param_regs.end()) {
+            is_reg_free[param_reg->second] = false;
+            active.push_back({ &interval, param_reg->second, true });
+            continue;
+        }
+
+        auto candidate_regs { get_candidate_regs(interval) };
+
+        int reg { -1 };
+        for (int candidate_reg: candidate_regs) {
+            if (is_reg_free[candidate_reg]) {
+                reg = candidate_reg;
+                break;
+            }
+        }
+
+        // the register of a parameter or argument it is copied to or from
+        // if free, which saves the copy
+        for (auto* partner: copy_partners[interval.id]) {
+            auto partner_reg { assigned_regs.find(partner) };
+            if (partner_reg == assigned_regs.end()) {
+                partner_reg = param_regs.find(partner);
+                if (partner_reg == param_regs.end()) continue;
+            }
+
+            int hint { partner_reg->second };
+            if (is_reg_free[hint] && std::find(candidate_regs.begin(), candidate_regs.end(), hint) != candidate_regs.end()) {
+                reg = hint;
+                break;
+            }
+        }
+
+        if (reg != -1) {
+            is_reg_free[reg] = false;
+            active.push_back({ &interval, reg, false });
+            assigned_regs.emplace(interval.id, reg);
+            continue;
+        }
+
+        /*
+         * no register left, spill whichever of the current interval and the
+         * active ones it could take a register from ends last
+         */
+        auto victim { active.end() };
+        for (auto it { active.begin() }; it != active.end(); it++) {
+            if (it->is_fixed || it->interval->end <= interval.end) continue;
+
+            bool is_candidate { false };
+            for (int candidate_reg: candidate_regs) {
+                is_candidate |= candidate_reg == it->reg;
+            }
+            if (!is_candidate) continue;
+
+            if (victim == active.end() || it->interval->end > victim->interval->end) {
+                victim = it;
+            }
+        }
+
+        if (victim == active.end()) {
+            stack_ids.push_back(interval.id);
+            continue;
+        }
+
+        reg = victim->reg;
+        assigned_regs.erase(victim->interval->id);
+        stack_ids.push_back(victim->interval->id);
+        active.erase(victim);
+
+        active.push_back({ &interval, reg, false });
+        assigned_regs.emplace(interval.id, reg);
+    }
+
+    for (auto [id, reg]: assigned_regs) {
+        id_storage_map.register_id(id, new Register(reg));
+    }
+
+    /*
+     * the calls within an interval left in a caller-saved register save it,
+     * which is harmless in the holes of the interval, the register being
+     * held for it all along
+     */
+    auto calls { get_indexed_calls(func_def) };
+    for (auto& interval: intervals) {
+        if (!interval.crosses_call) continue;
+
+        int reg;
+        if (param_regs.count(interval.id)) {
+            reg = param_regs.at(interval.id);
+        }
+        else if (assigned_regs.count(interval.id)) {
+            reg = assigned_regs.at(interval.id);
+        }
+        else continue;
+
+        if (Register(reg).is_callee_saved()) continue;
+
+        for (auto [stmt_index, func_call]: calls) {
+            if (interval.start <= 2 * stmt_index && 2 * stmt_index + 1 <= interval.end) {
+                current_call_saved_ids[func_call].push_back(interval.id);
+            }
+        }
+    }
+
+    return stack_ids;
+}
+
+}
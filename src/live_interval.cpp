@@ -0,0 +1,165 @@
+#include "allocate.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace riscv_trans {
+
+std::vector<koopa::Id*> get_pseudo_ids(const koopa::FuncDef* func_def) {
+    auto res { std::vector<koopa::Id*>() };
+
+    for (auto* block: func_def->get_blocks()) {
+        for (auto* stmt: block->get_stmts()) {
+            auto* symbol_def { dynamic_cast<koopa::SymbolDef*>(stmt) };
+            if (symbol_def == nullptr) continue;
+
+            auto* memory_decl { dynamic_cast<koopa::MemoryDecl*>(symbol_def->get_val()) };
+            if (memory_decl != nullptr) {
+                res.push_back(memory_decl->get_pseudo_id());
+            }
+        }
+    }
+
+    return res;
+}
+
+std::vector<koopa::Id*> get_value_ids(const koopa::FuncDef* func_def) {
+    auto res { std::vector<koopa::Id*>() };
+
+    for (auto* block: func_def->get_blocks()) {
+        auto& params { block->get_params() };
+        res.insert(res.end(), params.begin(), params.end());
+
+        for (auto* stmt: block->get_stmts()) {
+            if (auto* def_id { stmt->get_def_id() }) {
+                res.push_back(def_id);
+            }
+        }
+    }
+
+    return res;
+}
+
+koopa::FuncCall* get_func_call(koopa::Stmt* stmt) {
+    auto* symbol_def { dynamic_cast<koopa::SymbolDef*>(stmt) };
+    if (symbol_def != nullptr) {
+        return dynamic_cast<koopa::FuncCall*>(symbol_def->get_val());
+    }
+    return dynamic_cast<koopa::FuncCall*>(stmt);
+}
+
+std::vector<std::pair<int, koopa::FuncCall*>> get_indexed_calls(const koopa::FuncDef* func_def) {
+    auto res { std::vector<std::pair<int, koopa::FuncCall*>>() };
+
+    int stmt_index { 0 };
+    for (auto* block: func_def->get_blocks()) {
+        for (auto* stmt: block->get_stmts()) {
+            if (auto* func_call { get_func_call(stmt) }) {
+                res.push_back({ stmt_index, func_call });
+            }
+            stmt_index++;
+        }
+    }
+
+    return res;
+}
+
+std::vector<LiveInterval> build_live_intervals(
+    const koopa::FuncDef* func_def,
+    const std::vector<koopa::Id*>& ids
+) {
+    auto liveness { dataflow::analyze_liveness(func_def, ids) };
+    auto& numbering { liveness.numbering };
+    auto& blocks { liveness.graph.blocks };
+    int block_n { static_cast<int>(blocks.size()) };
+
+    std::vector<int> block_begins(block_n), block_ends(block_n);
+    std::vector<int> call_stmts;
+
+    int stmt_count { 0 };
+    for (int i { 0 }; i < block_n; i++) {
+        block_begins[i] = stmt_count;
+
+        for (auto* stmt: blocks[i]->get_stmts()) {
+            if (stmt->is_func_call()) {
+                call_stmts.push_back(stmt_count);
+            }
+            stmt_count++;
+        }
+
+        block_ends[i] = stmt_count - 1;
+    }
+
+    std::unordered_map<koopa::Id*, LiveInterval> intervals;
+    auto extend = [&](koopa::Id* id, int pos) {
+        auto res { intervals.find(id) };
+        if (res == intervals.end()) {
+            intervals.emplace(id, LiveInterval { id, pos, pos, false, false, 0, 0 });
+        }
+        else {
+            res->second.start = std::min(res->second.start, pos);
+            res->second.end = std::max(res->second.end, pos);
+        }
+    };
+
+    int stmt_index { 0 };
+    for (int i { 0 }; i < block_n; i++) {
+        if (block_begins[i] > block_ends[i]) continue; // empty block
+
+        liveness.live_in[i].for_each([&](int number) {
+            extend(numbering.get_id(number), 2 * block_begins[i]);
+        });
+        liveness.live_out[i].for_each([&](int number) {
+            extend(numbering.get_id(number), 2 * block_ends[i] + 1);
+        });
+
+        for (auto* stmt: blocks[i]->get_stmts()) {
+            for (auto* id: stmt->get_used_ids()) {
+                if (numbering.get_number(id) != -1) {
+                    extend(id, 2 * stmt_index);
+                    intervals.at(id).ref_n++;
+                }
+            }
+
+            for (auto* def_id: dataflow::get_def_ids(liveness.graph, i, stmt)) {
+                if (numbering.get_number(def_id) != -1) {
+                    extend(def_id, 2 * stmt_index + 1);
+                    intervals.at(def_id).ref_n++;
+                }
+            }
+
+            stmt_index++;
+        }
+    }
+
+    auto res { std::vector<LiveInterval>() };
+    res.reserve(intervals.size());
+    for (auto& [id, interval]: intervals) {
+        /*
+         * the call at statement `c` reads its arguments at `2c` and clobbers
+         * registers before writing its result at `2c + 1`
+         */
+        auto call { std::lower_bound(
+            call_stmts.begin(), call_stmts.end(), (interval.start + 1) / 2
+        ) };
+        if (call != call_stmts.end()) {
+            interval.covers_call = 2 * *call <= interval.end;
+            interval.crosses_call = 2 * *call + 1 <= interval.end;
+        }
+        if (interval.crosses_call) {
+            auto last_call { std::upper_bound(call_stmts.begin(), call_stmts.end(), (interval.end - 1) / 2) };
+            interval.crossed_call_n = last_call - call;
+        }
+        res.push_back(interval);
+    }
+
+    std::sort(res.begin(), res.end(), [](const LiveInterval& a, const LiveInterval& b) {
+        return a.start != b.start ? a.start < b.start : a.end < b.end;
+    });
+
+    return res;
+}
+
+}
@@ -0,0 +1,76 @@
+#include "liveness.h"
+#include "cfg.h"
+
+
+namespace dataflow {
+
+std::vector<koopa::Id*> get_def_ids(const FlowGraph& graph, int block, const koopa::Stmt* stmt) {
+    auto res { std::vector<koopa::Id*>() };
+
+    if (auto* def_id { stmt->get_def_id() }) {
+        res.push_back(def_id);
+    }
+
+    if (auto* jump { dynamic_cast<const koopa::Jump*>(stmt) }; jump != nullptr && !jump->get_args().empty()) {
+        res = graph.blocks[graph.succs[block][0]]->get_params();
+    }
+
+    // left unsplit by `riscv_trans::split_arg_edges` when lowered into
+    // something setting the parameters itself
+    if (auto* branch { dynamic_cast<const koopa::Branch*>(stmt) }) {
+        for (int k { 0 }; k < 2; k++) {
+            if (branch->get_target_args(k).empty()) continue;
+
+            auto& params { graph.blocks[graph.succs[block][k]]->get_params() };
+            res.insert(res.end(), params.begin(), params.end());
+        }
+    }
+
+    return res;
+}
+
+Liveness analyze_liveness(
+    const koopa::FuncDef* func_def,
+    const std::vector<koopa::Id*>& ids
+) {
+    Liveness res { get_cfg(func_def).get_graph(), ValueNumbering(ids), {}, {} };
+
+    int block_n { static_cast<int>(res.graph.blocks.size()) };
+    int bit_n { res.numbering.size() };
+
+    Problem problem {
+        Direction::Backward, Meet::Union, 
+        std::vector<BitSet>(block_n, BitSet(bit_n)), 
+        std::vector<BitSet>(block_n, BitSet(bit_n)), 
+        BitSet(bit_n)
+    };
+
+    for (int i { 0 }; i < block_n; i++) {
+        auto& gen { problem.gens[i] };
+        auto& kill { problem.kills[i] };
+
+        for (auto* stmt: res.graph.blocks[i]->get_stmts()) {
+            for (auto* id: stmt->get_used_ids()) {
+                int number { res.numbering.get_number(id) };
+                if (number != -1 && !kill.test(number)) {
+                    gen.set(number);
+                }
+            }
+
+            for (auto* def_id: get_def_ids(res.graph, i, stmt)) {
+                int number { res.numbering.get_number(def_id) };
+                if (number != -1) {
+                    kill.set(number);
+                }
+            }
+        }
+    }
+
+    auto solution { solve(res.graph, problem) };
+    res.live_in = std::move(solution.in);
+    res.live_out = std::move(solution.out);
+
+    return res;
+}
+
+}
@@ -0,0 +1,328 @@
+#include "machine_ir.h"
+#include "compiler_exception.hpp"
+
+#include <cassert>
+#include <unordered_set>
+#include <utility>
+
+namespace riscv_trans {
+
+static const char* opcode_names[] {
+    "li", "la", "mv",
+    "add", "addi", "sub", "mul", "mulh", "div", "rem",
+    "and", "andi", "or", "ori", "xor", "xori",
+    "sll", "slli", "srl", "srli", "sra", "srai",
+    "sh1add", "sh2add", "sh3add",
+    "min", "max",
+    "slt", "slti", "sgt", "seqz", "snez",
+    "lw", "sw",
+    "bnez", "beqz", "beq", "bne", "blt", "bge", "j", "call", "tail", "ret",
+    "#"
+};
+
+const char* get_opcode_name(Opcode opcode) {
+    return opcode_names[static_cast<int>(opcode)];
+}
+
+Opcode get_i_type_opcode(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::Add: return Opcode::Addi;
+        case Opcode::And: return Opcode::Andi;
+        case Opcode::Or: return Opcode::Ori;
+        case Opcode::Xor: return Opcode::Xori;
+        case Opcode::Sll: return Opcode::Slli;
+        case Opcode::Srl: return Opcode::Srli;
+        case Opcode::Sra: return Opcode::Srai;
+        case Opcode::Slt: return Opcode::Slti;
+        default: return opcode;
+    }
+}
+
+bool is_cond_branch(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::Bnez: case Opcode::Beqz: case Opcode::Beq: case Opcode::Bne:
+        case Opcode::Blt: case Opcode::Bge:
+            return true;
+        default:
+            return false;
+    }
+}
+
+Opcode get_inverse_branch(Opcode opcode) {
+    switch (opcode) {
+        case Opcode::Bnez: return Opcode::Beqz;
+        case Opcode::Beqz: return Opcode::Bnez;
+        case Opcode::Beq: return Opcode::Bne;
+        case Opcode::Bne: return Opcode::Beq;
+        case Opcode::Blt: return Opcode::Bge;
+        case Opcode::Bge: return Opcode::Blt;
+        default:
+            throw compiler_exception(
+                std::string("`") + get_opcode_name(opcode) + "` is not a conditional branch"
+            );
+    }
+}
+
+/*
+ * `std::unordered_set` never moves its elements, so the pointers handed out
+ * stay valid
+ */
+static const std::string* intern(std::string symbol) {
+    static std::unordered_set<std::string> symbols;
+    return &*symbols.insert(std::move(symbol)).first;
+}
+
+
+MachineOperand::MachineOperand(): kind(Kind::None), reg(0), imm(0), symbol(nullptr) {}
+MachineOperand::MachineOperand(Register reg)
+    : kind(Kind::Reg), reg(reg.get_serial_num()), imm(0), symbol(nullptr) {}
+MachineOperand::MachineOperand(int imm)
+    : kind(Kind::Imm), reg(0), imm(imm), symbol(nullptr) {}
+MachineOperand::MachineOperand(std::string symbol)
+    : kind(Kind::Symbol), reg(0), imm(0), symbol(intern(std::move(symbol))) {}
+
+MachineOperand MachineOperand::mem(int offset, Register base) {
+    MachineOperand res { base };
+    res.kind = Kind::Mem;
+    res.imm = offset;
+    return res;
+}
+
+MachineOperand::Kind MachineOperand::get_kind() const { return kind; }
+Register MachineOperand::get_reg() const { return Register(reg); }
+int MachineOperand::get_imm() const { return imm; }
+const std::string& MachineOperand::get_symbol() const { return *symbol; }
+
+void MachineOperand::print(std::string& str) const {
+    switch (kind) {
+        case Kind::None: break;
+        case Kind::Reg: str += abi_name[reg]; break;
+        case Kind::Imm: str += std::to_string(imm); break;
+        case Kind::Symbol: str += *symbol; break;
+        case Kind::Mem:
+            str += std::to_string(imm);
+            str += '(';
+            str += abi_name[reg];
+            str += ')';
+            break;
+    }
+}
+
+
+MachineInstr::MachineInstr(Opcode opcode, std::initializer_list<MachineOperand> operands)
+    : opcode(opcode), operand_n(operands.size()) {
+    if (operands.size() > MAX_OPERAND_N) {
+        throw compiler_exception(
+            std::string("too many operands for `") + get_opcode_name(opcode) + '`'
+        );
+    }
+
+    int i { 0 };
+    for (auto& operand: operands) {
+        this->operands[i++] = operand;
+    }
+}
+
+Opcode MachineInstr::get_opcode() const { return opcode; }
+void MachineInstr::set_opcode(Opcode opcode) { this->opcode = opcode; }
+int MachineInstr::get_operand_n() const { return operand_n; }
+MachineOperand& MachineInstr::get_operand(int i) { return operands[i]; }
+const MachineOperand& MachineInstr::get_operand(int i) const { return operands[i]; }
+
+bool MachineInstr::has_def() const {
+    switch (opcode) {
+        case Opcode::Sw: case Opcode::J: 
+        case Opcode::Call: case Opcode::Tail: case Opcode::Ret: case Opcode::Comment:
+            return false;
+        default:
+            return !is_cond_branch(opcode);
+    }
+}
+
+Register MachineInstr::get_def() const {
+    assert(has_def());
+    return operands[0].get_reg();
+}
+
+std::vector<Register> MachineInstr::get_uses() const {
+    if (opcode == Opcode::Call || opcode == Opcode::Tail || opcode == Opcode::Ret || opcode == Opcode::Comment) {
+        return {};
+    }
+
+    auto res { std::vector<Register>() };
+    for (int i { has_def() ? 1 : 0 }; i < operand_n; i++) {
+        auto kind { operands[i].get_kind() };
+        if (kind == MachineOperand::Kind::Reg || kind == MachineOperand::Kind::Mem) {
+            res.push_back(operands[i].get_reg());
+        }
+    }
+    return res;
+}
+
+bool MachineInstr::is_compressed() const { return is_compressed_bool; }
+void MachineInstr::set_compressed(bool is_compressed) { is_compressed_bool = is_compressed; }
+
+static bool is_sp(const MachineOperand& operand) {
+    return operand.get_reg().get_serial_num() == Register("sp").get_serial_num();
+}
+
+void MachineInstr::print(std::string& str) const {
+    if (opcode == Opcode::Comment) {
+        str += "\t# ";
+        operands[0].print(str);
+        str += '\n';
+        return;
+    }
+
+    // the forms based on sp have names of their own, `c.addi16sp` leaving
+    // out its source and `c.jr` naming ra `ret` leaves implicit. The other
+    // arithmetic forms write their first source, which is left out as well,
+    // e.g. `c.add a0, a1` for `add a0, a0, a1`
+    auto name { std::string(get_opcode_name(opcode)) };
+    auto printed_operands { std::vector<const MachineOperand*>() };
+    for (int i { 0 }; i < operand_n; i++) {
+        printed_operands.push_back(&operands[i]);
+    }
+
+    static const MachineOperand ra { Register("ra") };
+    if (is_compressed_bool) {
+        if ((opcode == Opcode::Lw || opcode == Opcode::Sw) && is_sp(operands[1])) {
+            name += "sp";
+        }
+        else if (opcode == Opcode::Addi && is_sp(operands[1])) {
+            if (is_sp(operands[0])) {
+                name += "16sp";
+                printed_operands.erase(printed_operands.begin() + 1);
+            }
+            else {
+                name += "4spn";
+            }
+        }
+        else if (opcode == Opcode::Ret) {
+            name = "jr";
+            printed_operands.push_back(&ra);
+        }
+        else if (operand_n == 3 && operands[1].get_kind() == MachineOperand::Kind::Reg) {
+            printed_operands.erase(printed_operands.begin() + 1);
+        }
+        name = "c." + name;
+    }
+
+    // opcode aligned to 8 characters, a space at least after longer ones
+    str += '\t';
+    auto name_begin { str.size() };
+    str += name;
+    str.append(name_begin + 8 > str.size() ? name_begin + 8 - str.size() : 1, ' ');
+
+    for (int i { 0 }; i < printed_operands.size(); i++) {
+        if (i != 0) str += ", ";
+        printed_operands[i]->print(str);
+    }
+    str += '\n';
+}
+
+std::string MachineInstr::to_string() const {
+    auto res { std::string() };
+    print(res);
+    return res;
+}
+
+
+void operator+=(MachineBasicBlock& self, MachineInstr instr) {
+    self.instrs.push_back(instr);
+}
+
+void operator+=(MachineBasicBlock& self, std::vector<MachineInstr> instrs) {
+    self.instrs.insert(self.instrs.end(), instrs.begin(), instrs.end());
+}
+
+MachineBasicBlock::MachineBasicBlock(std::string label): label(label) {}
+
+std::string MachineBasicBlock::get_label() const { return label; }
+std::vector<MachineInstr>& MachineBasicBlock::get_instrs() { return instrs; }
+const std::vector<MachineInstr>& MachineBasicBlock::get_instrs() const { return instrs; }
+
+void MachineBasicBlock::print(std::string& str) const {
+    str += label;
+    str += ":\n";
+    for (auto& instr: instrs) {
+        instr.print(str);
+    }
+}
+
+
+MachineFunction::MachineFunction(std::string name): name(name) {}
+
+std::string MachineFunction::get_name() const { return name; }
+std::vector<MachineBasicBlock>& MachineFunction::get_blocks() { return blocks; }
+const std::vector<MachineBasicBlock>& MachineFunction::get_blocks() const { return blocks; }
+
+void MachineFunction::print(std::string& str) const {
+    for (auto& block: blocks) {
+        block.print(str);
+    }
+}
+
+
+MachineGlobal::MachineGlobal(std::string name, std::string comment)
+    : name(name), comment(comment) {}
+
+std::string MachineGlobal::get_name() const { return name; }
+std::vector<MachineGlobal::Directive>& MachineGlobal::get_directives() { return directives; }
+MachineGlobal::Section MachineGlobal::get_section() const { return section; }
+void MachineGlobal::set_section(Section section) { this->section = section; }
+void MachineGlobal::set_align(int align) { this->align = align; }
+
+void MachineGlobal::print(std::string& str) const {
+    if (!comment.empty()) {
+        str += "\t# " + comment + '\n';
+    }
+
+    str += "\t.global " + name + '\n';
+    if (align > 2) {
+        str += "\t.p2align " + std::to_string(align) + '\n';
+    }
+    str += name + ":\n";
+
+    for (auto& directive: directives) {
+        str += directive.kind == Directive::Kind::Word ? "\t.word " : "\t.zero ";
+        str += std::to_string(directive.val) + '\n';
+    }
+}
+
+
+void MachineModule::print(std::string& str) const {
+    static const std::pair<MachineGlobal::Section, const char*> sections[] {
+        { MachineGlobal::Section::Data, "\t.data\n" },
+        { MachineGlobal::Section::Rodata, "\t.section .rodata\n" },
+        { MachineGlobal::Section::Bss, "\t.bss\n" },
+    };
+
+    for (auto [section, header]: sections) {
+        bool is_empty { true };
+        for (auto& global: globals) {
+            if (global.get_section() != section) continue;
+
+            if (is_empty) {
+                str += header;
+                is_empty = false;
+            }
+            global.print(str);
+        }
+    }
+
+    str += "\t.text\n";
+    str += "\t.global main\n";
+    for (auto& function: functions) {
+        function.print(str);
+    }
+}
+
+std::vector<MachineGlobal>& MachineModule::get_globals() { return globals; }
+std::vector<MachineFunction>& MachineModule::get_functions() { return functions; }
+
+MachineBasicBlock& MachineModule::get_insert_block() {
+    return functions.back().get_blocks().back();
+}
+
+}
@@ -14,6 +14,12 @@
 
 #include "ast.h"
 #include "koopa.h"
+#include "riscv_trans.h"
+#include "peephole.h"
+#include "block_layout.h"
+#include "mem2reg.h"
+#include "pass_manager.h"
+#include "sccp.h"
 #include "def.h"
 #include "compiler_exception.hpp"
 
@@ -56,6 +62,60 @@ void handle_args(
 	    else if (!strcmp(argv[i], "-dbg-r")) {
 		    debug_mode_riscv = true;
 		}
+	    else if (!strcmp(argv[i], "-dbg-ra")) {
+		    debug_mode_regalloc = true;
+		}
+	    else if (!strcmp(argv[i], "-dbg-ph")) {
+		    debug_mode_peephole = true;
+		}
+	    else if (!strcmp(argv[i], "-dbg-rvc")) {
+		    debug_mode_rvc = true;
+		}
+	    else if (!strcmp(argv[i], "-time-passes")) {
+		    debug_mode_time_passes = true;
+		}
+	    else if (!strcmp(argv[i], "-no-peephole")) {
+		    riscv_trans::enable_peephole = false;
+		}
+	    else if (!strcmp(argv[i], "-no-block-layout")) {
+		    riscv_trans::enable_block_layout = false;
+		}
+	    else if (!strcmp(argv[i], "-no-tail-call")) {
+		    riscv_trans::enable_tail_call = false;
+		}
+	    else if (!strcmp(argv[i], "-no-frame-anchor")) {
+		    riscv_trans::enable_frame_anchor = false;
+		}
+	    else if (!strcmp(argv[i], "-no-mem2reg")) {
+		    koopa_opt::enable_mem2reg = false;
+		}
+	    else if (!strcmp(argv[i], "-no-sccp")) {
+		    koopa_opt::enable_sccp = false;
+		}
+	    else if (!strncmp(argv[i], "-O", strlen("-O"))) {
+		    koopa_opt::set_opt_level(argv[i] + strlen("-O"));
+		}
+	    else if (!strncmp(argv[i], "-passes=", strlen("-passes="))) {
+		    koopa_opt::set_passes(argv[i] + strlen("-passes="));
+		}
+	    else if (!strncmp(argv[i], "-march=", strlen("-march="))) {
+		    riscv_trans::set_target_arch(argv[i] + strlen("-march="));
+		}
+	    else if (!strncmp(argv[i], "-regalloc=", strlen("-regalloc="))) {
+		    std::string strategy { argv[i] + strlen("-regalloc=") };
+		    if (strategy == "naive") {
+			    riscv_trans::reg_alloc_strategy = riscv_trans::RegAllocStrategy::Naive;
+			}
+		    else if (strategy == "linear-scan") {
+			    riscv_trans::reg_alloc_strategy = riscv_trans::RegAllocStrategy::LinearScan;
+			}
+		    else if (strategy == "graph-coloring") {
+			    riscv_trans::reg_alloc_strategy = riscv_trans::RegAllocStrategy::GraphColoring;
+			}
+		    else {
+			    throw compiler_exception("unknown register allocation strategy `" + strategy + '`');
+			}
+		}
 	    else { input = argv[i]; }
 	}
 
@@ -93,6 +153,8 @@ int main(int argc, const char* argv[]) {
 
 				auto* koopa { ast->to_koopa() };
 
+				koopa_opt::run_passes(koopa);
+
 				if (mode == "-koopa") {
 					os << koopa->to_string();
 			} 
@@ -0,0 +1,253 @@
+#include "mem2reg.h"
+#include "cfg.h"
+#include "name.h"
+#include "value_manager.h"
+
+#include <cassert>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace koopa_opt {
+
+bool enable_mem2reg { true };
+
+/**
+ * @return  address `stmt` loads from or stores a value to, nullptr if it
+ *          does neither
+ */
+static koopa::Id* get_accessed_addr(koopa::Stmt* stmt) {
+    if (auto* store { dynamic_cast<koopa::StoreValue*>(stmt) }) {
+        return store->get_value() != store->get_addr() ? store->get_addr() : nullptr;
+    }
+
+    auto* symbol_def { dynamic_cast<koopa::SymbolDef*>(stmt) };
+    auto* load { symbol_def ? dynamic_cast<koopa::Load*>(symbol_def->get_val()) : nullptr };
+    return load ? load->get_addr() : nullptr;
+}
+
+/**
+ * @return  addresses declared by `alloc` in `blocks` holding an `i32` or a
+ *          pointer, which nothing but loads and stores refers to
+ */
+static std::vector<koopa::Id*> get_promotable_addrs(const std::vector<koopa::Block*>& blocks) {
+    auto escaped_addrs { std::unordered_set<koopa::Id*>() };
+    for (auto* block: blocks) {
+        for (auto* stmt: block->get_stmts()) {
+            auto* accessed_addr { get_accessed_addr(stmt) };
+            for (auto* id: stmt->get_used_ids()) {
+                if (id != accessed_addr) escaped_addrs.insert(id);
+            }
+        }
+    }
+
+    auto res { std::vector<koopa::Id*>() };
+    for (auto* block: blocks) {
+        for (auto* stmt: block->get_stmts()) {
+            auto* symbol_def { dynamic_cast<koopa::SymbolDef*>(stmt) };
+            if (symbol_def == nullptr || dynamic_cast<koopa::MemoryDecl*>(symbol_def->get_val()) == nullptr) continue;
+
+            auto* addr { symbol_def->get_def_id() };
+            auto type_id { addr->get_type()->unwrap()->get_type_id() };
+            if ((type_id == koopa::Type::TypeId::Int || type_id == koopa::Type::TypeId::Pointer)
+                && escaped_addrs.count(addr) == 0) {
+                res.push_back(addr);
+            }
+        }
+    }
+    return res;
+}
+
+/**
+ * @return  for each block, the numbers of the addresses it takes a parameter
+ *          for: those in the iterated dominance frontier of the blocks
+ *          storing to the address, and still loaded from past them
+ */
+static std::vector<std::vector<int>> place_params(
+    const dataflow::Cfg& cfg,
+    const dataflow::ValueNumbering& numbering
+) {
+    auto& graph { cfg.get_graph() };
+    int block_n { static_cast<int>(graph.blocks.size()) };
+    int bit_n { numbering.size() };
+
+    // loaded before being stored to, and stored to
+    dataflow::Problem problem {
+        dataflow::Direction::Backward, dataflow::Meet::Union,
+        std::vector<dataflow::BitSet>(block_n, dataflow::BitSet(bit_n)),
+        std::vector<dataflow::BitSet>(block_n, dataflow::BitSet(bit_n)),
+        dataflow::BitSet(bit_n)
+    };
+    for (int i { 0 }; i < block_n; i++) {
+        for (auto* stmt: graph.blocks[i]->get_stmts()) {
+            int number { numbering.get_number(get_accessed_addr(stmt)) };
+            if (number == -1) continue;
+
+            if (dynamic_cast<koopa::StoreValue*>(stmt)) {
+                problem.kills[i].set(number);
+            }
+            else if (!problem.kills[i].test(number)) {
+                problem.gens[i].set(number);
+            }
+        }
+    }
+    auto liveness { dataflow::solve(graph, problem) };
+
+    auto frontiers { dataflow::get_dominance_frontiers(cfg) };
+
+    std::vector<std::vector<int>> res(block_n);
+    for (int number { 0 }; number < bit_n; number++) {
+        std::vector<bool> has_param(block_n, false);
+        std::vector<int> worklist;
+        for (int i { 0 }; i < block_n; i++) {
+            if (problem.kills[i].test(number)) worklist.push_back(i);
+        }
+
+        while (!worklist.empty()) {
+            int block { worklist.back() };
+            worklist.pop_back();
+
+            for (int frontier: frontiers[block]) {
+                if (has_param[frontier] || !liveness.in[frontier].test(number)) continue;
+
+                has_param[frontier] = true;
+                res[frontier].push_back(number);
+                // a new definition of the address, spreading to its own frontier
+                worklist.push_back(frontier);
+            }
+        }
+    }
+
+    return res;
+}
+
+/*
+ * replaces the loads and stores of the promoted addresses walking down the
+ * dominator tree, with a stack of the values each address holds
+ */
+class Renamer {
+public:
+    Renamer(
+        const dataflow::Cfg& cfg,
+        const dataflow::ValueNumbering& numbering,
+        const std::unordered_map<koopa::Block*, std::vector<int>>& param_numbers
+    ): cfg(cfg), numbering(numbering), param_numbers(param_numbers),
+        stacks(numbering.size(), { value_manager.new_const(0) }) {}
+
+    void rename(int block);
+
+private:
+    const dataflow::Cfg& cfg;
+    const dataflow::ValueNumbering& numbering;
+    const std::unordered_map<koopa::Block*, std::vector<int>>& param_numbers;
+
+    std::vector<std::vector<koopa::Value*>> stacks;
+    // loads removed, to the values they read
+    std::unordered_map<koopa::Id*, koopa::Value*> values;
+
+    const std::vector<int>& get_param_numbers(koopa::Block* block) const {
+        static const std::vector<int> none;
+        auto it { param_numbers.find(block) };
+        return it != param_numbers.end() ? it->second : none;
+    }
+};
+
+void Renamer::rename(int block) {
+    auto* self { cfg.get_block(block) };
+    auto pushed_numbers { std::vector<int>() };
+
+    auto& self_param_numbers { get_param_numbers(self) };
+    for (int i { 0 }; i < self_param_numbers.size(); i++) {
+        stacks[self_param_numbers[i]].push_back(self->get_params()[i]);
+        pushed_numbers.push_back(self_param_numbers[i]);
+    }
+
+    auto stmts { std::vector<koopa::Stmt*>() };
+    for (auto* stmt: self->get_stmts()) {
+        stmt->replace_uses(values);
+
+        auto* symbol_def { dynamic_cast<koopa::SymbolDef*>(stmt) };
+        if (symbol_def != nullptr && numbering.get_number(symbol_def->get_def_id()) != -1) {
+            continue; // the `alloc`
+        }
+
+        int number { numbering.get_number(get_accessed_addr(stmt)) };
+        if (number == -1) {
+            stmts.push_back(stmt);
+        }
+        else if (auto* store { dynamic_cast<koopa::StoreValue*>(stmt) }) {
+            stacks[number].push_back(store->get_value());
+            pushed_numbers.push_back(number);
+        }
+        else {
+            values[symbol_def->get_def_id()] = stacks[number].back();
+        }
+    }
+
+    auto& succs { cfg.get_succs(block) };
+    for (int k { 0 }; k < succs.size(); k++) {
+        auto& succ_param_numbers { get_param_numbers(cfg.get_block(succs[k])) };
+        if (succ_param_numbers.empty()) continue;
+
+        auto args { std::vector<koopa::Value*>() };
+        for (int number: succ_param_numbers) {
+            args.push_back(stacks[number].back());
+        }
+
+        if (auto* jump { dynamic_cast<koopa::Jump*>(stmts.back()) }) {
+            jump->set_args(args);
+        }
+        else {
+            auto* branch { dynamic_cast<koopa::Branch*>(stmts.back()) };
+            assert(branch != nullptr);
+            branch->set_target_args(k, args);
+        }
+    }
+
+    self->get_stmts() = std::move(stmts);
+
+    for (int child: cfg.get_dom_children(block)) {
+        rename(child);
+    }
+
+    for (int number: pushed_numbers) {
+        stacks[number].pop_back();
+    }
+}
+
+bool mem2reg(koopa::FuncDef* func_def) {
+    bool is_changed { dataflow::remove_unreachable_blocks(func_def) };
+
+    auto& cfg { dataflow::get_cfg(func_def) };
+    auto& graph { cfg.get_graph() };
+    if (graph.blocks.empty() || !graph.preds[0].empty()) return is_changed;
+
+    auto addrs { get_promotable_addrs(graph.blocks) };
+    if (addrs.empty()) return is_changed;
+    dataflow::ValueNumbering numbering(addrs);
+
+    auto block_param_numbers { place_params(cfg, numbering) };
+
+    value_manager.enter_func(func_def->get_id()->get_lit());
+
+    auto param_numbers { std::unordered_map<koopa::Block*, std::vector<int>>() };
+    for (int i { 0 }; i < graph.blocks.size(); i++) {
+        if (block_param_numbers[i].empty()) continue;
+
+        auto* block { graph.blocks[i] };
+        param_numbers[block] = block_param_numbers[i];
+        for (int number: block_param_numbers[i]) {
+            block->get_params().push_back(
+                value_manager.new_id(numbering.get_id(number)->get_type()->unwrap(), new_id_name())
+            );
+        }
+    }
+
+    value_manager.leave_func();
+
+    Renamer(cfg, numbering, param_numbers).rename(0);
+    return true;
+}
+
+}
@@ -0,0 +1,82 @@
+#include "out_of_ssa.h"
+#include "cfg.h"
+#include "name.h"
+
+#include <algorithm>
+
+namespace riscv_trans {
+
+void split_arg_edges(
+    koopa::FuncDef* func_def,
+    const std::function<bool(const koopa::Branch*)>& is_kept
+) {
+    auto blocks { std::vector<koopa::Block*>() };
+    bool is_changed { false };
+
+    for (auto* block: func_def->get_blocks()) {
+        blocks.push_back(block);
+
+        auto& stmts { block->get_stmts() };
+        auto* branch { stmts.empty() ? nullptr : dynamic_cast<koopa::Branch*>(stmts.back()) };
+        if (branch == nullptr || is_kept(branch)) continue;
+
+        auto targets { branch->get_target_labels() };
+        for (int k { 0 }; k < targets.size(); k++) {
+            auto args { branch->get_target_args(k) };
+            if (args.empty()) continue;
+
+            auto* edge_block { new koopa::Block(koopa::Label(new_block_name()), { new koopa::Jump(targets[k], args) }) };
+            branch->set_target_label(k, edge_block->get_label());
+            branch->set_target_args(k, {});
+            blocks.push_back(edge_block);
+            is_changed = true;
+        }
+    }
+
+    if (is_changed) {
+        func_def->set_blocks(blocks);
+        dataflow::invalidate_cfg(func_def);
+    }
+}
+
+std::vector<Copy> sequentialize_copies(std::vector<Copy> copies, int scratch) {
+    auto res { std::vector<Copy>() };
+
+    copies.erase(std::remove_if(copies.begin(), copies.end(), [](const Copy& copy) {
+        return copy.dst == copy.src;
+    }), copies.end());
+
+    auto is_read = [&](int location) {
+        return std::any_of(copies.begin(), copies.end(), [&](const Copy& copy) {
+            return copy.src == location;
+        });
+    };
+
+    while (!copies.empty()) {
+        auto ready { std::find_if(copies.begin(), copies.end(), [&](const Copy& copy) {
+            return !is_read(copy.dst);
+        }) };
+
+        if (ready != copies.end()) {
+            res.push_back(*ready);
+            copies.erase(ready);
+            continue;
+        }
+
+        /*
+         * every location left to be written is still to be read, so the copies
+         * form cycles. Saving one location breaks its cycle into a chain, all
+         * of which is ready before another cycle is broken, so `scratch` is
+         * free again by then
+         */
+        int saved { copies.front().dst };
+        res.push_back({ scratch, saved });
+        for (auto& copy: copies) {
+            if (copy.src == saved) copy.src = scratch;
+        }
+    }
+
+    return res;
+}
+
+}
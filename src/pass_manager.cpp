@@ -0,0 +1,202 @@
+#include "pass_manager.h"
+#include "cfg.h"
+#include "mem2reg.h"
+#include "sccp.h"
+#include "def.h"
+#include "compiler_exception.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <unordered_map>
+
+namespace koopa_opt {
+
+static int opt_level { 2 };
+
+// whether `-passes=` names the passes to run, in `pass_names`
+static bool is_pipeline_overridden { false };
+static std::vector<std::string> pass_names;
+
+/*
+ * check that every block of every function ends in its only `br`, `jump` or
+ * `ret`, that the labels jumped to are blocks of the function, and that as
+ * many arguments are passed to a block as it has parameters
+ *
+ * @throw  <compiler_exception> naming the function and the block otherwise
+ */
+static bool verify(koopa::Program* program) {
+    for (auto* global_stmt: program->get_global_stmts()) {
+        auto* func_def { dynamic_cast<koopa::FuncDef*>(global_stmt) };
+        if (func_def == nullptr) continue;
+
+        auto blocks { std::unordered_map<std::string, koopa::Block*>() };
+        for (auto* block: func_def->get_blocks()) {
+            blocks.emplace(block->get_label().get_name(), block);
+        }
+
+        for (auto* block: func_def->get_blocks()) {
+            auto where { "`" + func_def->get_id()->get_lit() + "`, block `" + block->get_label().get_name() + "`" };
+
+            auto& stmts { block->get_stmts() };
+            for (int i { 0 }; i < stmts.size(); i++) {
+                if (stmts[i]->is_end_stmt() != (i + 1 == stmts.size())) {
+                    throw compiler_exception("verify: " + where + " does not end in its only terminator");
+                }
+            }
+            if (stmts.empty()) {
+                throw compiler_exception("verify: " + where + " is empty");
+            }
+
+            auto check_target = [&](const koopa::Label& label, const std::vector<koopa::Value*>& args) {
+                auto target { blocks.find(label.get_name()) };
+                if (target == blocks.end()) {
+                    throw compiler_exception("verify: " + where + " jumps to unknown `" + label.get_name() + "`");
+                }
+                if (args.size() != target->second->get_params().size()) {
+                    throw compiler_exception("verify: " + where + " passes a wrong number of arguments to `" + label.get_name() + "`");
+                }
+            };
+
+            if (auto* jump { dynamic_cast<koopa::Jump*>(stmts.back()) }) {
+                check_target(jump->get_target_labels()[0], jump->get_args());
+            }
+            else if (auto* branch { dynamic_cast<koopa::Branch*>(stmts.back()) }) {
+                auto targets { branch->get_target_labels() };
+                for (int k { 0 }; k < targets.size(); k++) {
+                    check_target(targets[k], branch->get_target_args(k));
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+static const std::vector<Pass> passes {
+    { "mem2reg", PassKind::Function, mem2reg, nullptr, true },
+    { "sccp", PassKind::Function, sccp, nullptr, false },
+    { "verify", PassKind::Module, nullptr, verify, true },
+};
+
+const Pass& get_pass(const std::string& name) {
+    for (auto& pass: passes) {
+        if (pass.name == name) return pass;
+    }
+    throw compiler_exception("unknown pass `" + name + '`');
+}
+
+std::vector<std::string> get_pipeline(int opt_level) {
+    auto res { std::vector<std::string>() };
+
+    if (opt_level >= 1 && enable_mem2reg) {
+        res.push_back("mem2reg");
+    }
+    if (opt_level >= 2 && enable_sccp) {
+        res.push_back("sccp");
+    }
+
+    return res;
+}
+
+void set_opt_level(std::string level) {
+    if (level != "0" && level != "1" && level != "2") {
+        throw compiler_exception("unsupported optimization level `-O" + level + '`');
+    }
+    opt_level = level[0] - '0';
+}
+
+void set_passes(std::string names) {
+    is_pipeline_overridden = true;
+    pass_names.clear();
+
+    for (std::string::size_type begin { 0 }; begin <= names.size(); ) {
+        auto end { names.find(',', begin) };
+        if (end == std::string::npos) end = names.size();
+
+        auto name { names.substr(begin, end - begin) };
+        if (!name.empty()) {
+            get_pass(name);
+            pass_names.push_back(name);
+        }
+
+        begin = end + 1;
+    }
+}
+
+struct IrSize {
+    int block_n;
+    int stmt_n;
+};
+
+static IrSize get_ir_size(const koopa::Program* program) {
+    IrSize res { 0, 0 };
+    for (auto* global_stmt: program->get_global_stmts()) {
+        auto* func_def { dynamic_cast<koopa::FuncDef*>(global_stmt) };
+        if (func_def == nullptr) continue;
+
+        for (auto* block: func_def->get_blocks()) {
+            res.block_n++;
+            res.stmt_n += block->get_stmts().size();
+        }
+    }
+    return res;
+}
+
+static void run_pass(const Pass& pass, koopa::Program* program) {
+    if (pass.kind == PassKind::Module) {
+        if (pass.run_on_program(program) && !pass.preserves_cfg) {
+            for (auto* global_stmt: program->get_global_stmts()) {
+                if (auto* func_def { dynamic_cast<koopa::FuncDef*>(global_stmt) }) {
+                    dataflow::invalidate_cfg(func_def);
+                }
+            }
+        }
+        return;
+    }
+
+    for (auto* global_stmt: program->get_global_stmts()) {
+        auto* func_def { dynamic_cast<koopa::FuncDef*>(global_stmt) };
+        if (func_def == nullptr || !pass.run_on_func(func_def)) continue;
+
+        if (!pass.preserves_cfg) {
+            dataflow::invalidate_cfg(func_def);
+        }
+
+        // the copy printed in place of an earlier declaration
+        auto implementation { koopa::FuncDecl::func_implementations.find(func_def->get_id()) };
+        if (implementation != koopa::FuncDecl::func_implementations.end()) {
+            implementation->second->set_blocks(func_def->get_blocks());
+        }
+    }
+}
+
+void run_passes(koopa::Program* program) {
+    auto names { is_pipeline_overridden ? pass_names : get_pipeline(opt_level) };
+
+    for (auto& name: names) {
+        auto& pass { get_pass(name) };
+
+        if (!debug_mode_time_passes) {
+            run_pass(pass, program);
+            continue;
+        }
+
+        auto old_size { get_ir_size(program) };
+        auto begin { std::chrono::steady_clock::now() };
+
+        run_pass(pass, program);
+
+        auto end { std::chrono::steady_clock::now() };
+        auto new_size { get_ir_size(program) };
+
+        char time[32];
+        snprintf(time, sizeof(time), "%.3f", std::chrono::duration<double, std::milli>(end - begin).count());
+
+        std::cerr << name << ": " << time << " ms, "
+            << old_size.block_n << " blocks " << old_size.stmt_n << " stmts -> "
+            << new_size.block_n << " blocks " << new_size.stmt_n << " stmts" << std::endl;
+    }
+}
+
+}
@@ -0,0 +1,313 @@
+#include "peephole.h"
+#include "strength_reduction.h"
+
+#include <iostream>
+#include <vector>
+
+namespace riscv_trans {
+
+bool enable_peephole { true };
+
+/*
+ * t0-t2 are the scratch registers of `TempRegManager`, handed out while a
+ * single koopa statement is translated, so their values never outlive the
+ * statement, let alone the block. The one exception is the pointer and bound
+ * of the loop zeroing a local array, live across its blocks, whose
+ * instructions match no rule that asks for deadness
+ */
+static bool is_scratch_reg(Register reg) {
+    static const int t0 { Register("t0").get_serial_num() };
+    static const int t2 { Register("t2").get_serial_num() };
+    int serial_num { reg.get_serial_num() };
+    return serial_num >= t0 && serial_num <= t2;
+}
+
+static bool is_arg_reg(Register reg) {
+    static const int a0 { Register("a0").get_serial_num() };
+    static const int a7 { Register("a7").get_serial_num() };
+    int serial_num { reg.get_serial_num() };
+    return serial_num >= a0 && serial_num <= a7;
+}
+
+static bool is_temp_reg(Register reg) {
+    return reg.get_lit().at(0) == 't';
+}
+
+static bool is_same_reg(Register a, Register b) {
+    return a.get_serial_num() == b.get_serial_num();
+}
+
+static bool is_reg(const MachineOperand& operand, Register reg) {
+    return operand.get_kind() == MachineOperand::Kind::Reg && is_same_reg(operand.get_reg(), reg);
+}
+
+static bool is_same_mem(const MachineOperand& a, const MachineOperand& b) {
+    return a.get_kind() == MachineOperand::Kind::Mem && b.get_kind() == MachineOperand::Kind::Mem
+        && is_same_reg(a.get_reg(), b.get_reg()) && a.get_imm() == b.get_imm();
+}
+
+/*
+ * the liveness scan gives up, taking the register as live, after this many
+ * instructions
+ */
+static constexpr int DEAD_SCAN_LIMIT = 32;
+
+/**
+ * @return  whether the value `reg` holds before `instrs[begin]` is never read
+ */
+static bool is_dead_from(const std::vector<MachineInstr>& instrs, int begin, Register reg) {
+    if (!is_temp_reg(reg) && !is_arg_reg(reg) && !reg.is_callee_saved()) {
+        return false; // sp, ra and the like
+    }
+
+    bool is_scratch { is_scratch_reg(reg) };
+
+    int scanned_n { 0 };
+    for (int i { begin }; i < instrs.size() && scanned_n < DEAD_SCAN_LIMIT; i++) {
+        auto& instr { instrs[i] };
+
+        switch (instr.get_opcode()) {
+            case Opcode::Comment:
+                continue;
+
+            // arguments are read, the other caller-saved registers clobbered
+            case Opcode::Call:
+                if (is_arg_reg(reg)) return false;
+                if (is_temp_reg(reg)) return true;
+                break;
+
+            case Opcode::Ret:
+                return !is_same_reg(reg, Register("a0")) && !reg.is_callee_saved();
+
+            // the arguments of the callee are read
+            case Opcode::Tail:
+                return !is_arg_reg(reg) && !reg.is_callee_saved();
+
+            case Opcode::J:
+                return is_scratch;
+
+            default:
+                for (auto use: instr.get_uses()) {
+                    if (is_same_reg(use, reg)) return false;
+                }
+                if (instr.has_def() && is_same_reg(instr.get_def(), reg)) return true;
+
+                // the other successor of a branch
+                if (is_cond_branch(instr.get_opcode()) && !is_scratch) return false;
+                break;
+        }
+
+        scanned_n++;
+    }
+
+    return is_scratch && scanned_n < DEAD_SCAN_LIMIT;
+}
+
+/*
+ * the last instructions of the block being rewritten, comments skipped
+ */
+class Window {
+public:
+    Window(
+        std::vector<MachineInstr>& done, std::vector<int> indexes,
+        const std::vector<MachineInstr>& rest, int rest_begin
+    ): done(done), indexes(indexes), rest(rest), rest_begin(rest_begin) {}
+
+    const MachineInstr& operator[](int i) const { return done[indexes[i]]; }
+
+    /**
+     * @return  whether the value of `reg` after the window is never read
+     */
+    bool is_dead_after(Register reg) const { return is_dead_from(rest, rest_begin, reg); }
+
+private:
+    std::vector<MachineInstr>& done;
+    std::vector<int> indexes;
+    const std::vector<MachineInstr>& rest;
+    int rest_begin;
+};
+
+struct PeepholeRule {
+    const char* name;
+    int size;
+    bool (*match)(const Window& window);
+    std::vector<MachineInstr> (*rewrite)(const Window& window);
+};
+
+/*
+ * rules are tried in order on the end of the instructions rewritten so far,
+ * each time an instruction is appended or a rule fires
+ */
+static const PeepholeRule rules[] {
+    {
+        // mv t0, t0
+        "mv-self", 1,
+        [](const Window& w) {
+            return w[0].get_opcode() == Opcode::Mv && is_reg(w[0].get_operand(1), w[0].get_def());
+        },
+        [](const Window& w) { return std::vector<MachineInstr>(); }
+    },
+    {
+        // addi t0, t1, 0  =>  mv t0, t1
+        "addi-zero", 1,
+        [](const Window& w) {
+            return w[0].get_opcode() == Opcode::Addi && w[0].get_operand(2).get_imm() == 0;
+        },
+        [](const Window& w) {
+            return std::vector<MachineInstr> {
+                MachineInstr(Opcode::Mv, { w[0].get_operand(0), w[0].get_operand(1) })
+            };
+        }
+    },
+    {
+        // sw t0, 8(sp); lw t1, 8(sp)  =>  sw t0, 8(sp); mv t1, t0
+        "store-load", 2,
+        [](const Window& w) {
+            return w[0].get_opcode() == Opcode::Sw && w[1].get_opcode() == Opcode::Lw
+                && is_same_mem(w[0].get_operand(1), w[1].get_operand(1));
+        },
+        [](const Window& w) {
+            return std::vector<MachineInstr> {
+                w[0], MachineInstr(Opcode::Mv, { w[1].get_operand(0), w[0].get_operand(0) })
+            };
+        }
+    },
+    {
+        // lw t0, 8(sp); lw t1, 8(sp)  =>  lw t0, 8(sp); mv t1, t0
+        "load-load", 2,
+        [](const Window& w) {
+            return w[0].get_opcode() == Opcode::Lw && w[1].get_opcode() == Opcode::Lw
+                && is_same_mem(w[0].get_operand(1), w[1].get_operand(1))
+                && !is_same_reg(w[0].get_def(), w[0].get_operand(1).get_reg());
+        },
+        [](const Window& w) {
+            return std::vector<MachineInstr> {
+                w[0], MachineInstr(Opcode::Mv, { w[1].get_operand(0), w[0].get_operand(0) })
+            };
+        }
+    },
+    {
+        // sw t0, 8(sp); sw t1, 8(sp)  =>  sw t1, 8(sp)
+        "dead-store", 2,
+        [](const Window& w) {
+            return w[0].get_opcode() == Opcode::Sw && w[1].get_opcode() == Opcode::Sw
+                && is_same_mem(w[0].get_operand(1), w[1].get_operand(1));
+        },
+        [](const Window& w) { return std::vector<MachineInstr> { w[1] }; }
+    },
+    {
+        // li t0, 8; mul t1, t2, t0  =>  slli t1, t2, 3
+        "mul-pow2", 2,
+        [](const Window& w) {
+            if (w[0].get_opcode() != Opcode::Li || w[1].get_opcode() != Opcode::Mul) return false;
+            if (get_log2(w[0].get_operand(1).get_imm()) == -1) return false;
+
+            auto li_reg { w[0].get_def() };
+            bool is_lhs { is_reg(w[1].get_operand(1), li_reg) };
+            bool is_rhs { is_reg(w[1].get_operand(2), li_reg) };
+
+            return is_lhs != is_rhs
+                && (is_same_reg(w[1].get_def(), li_reg) || w.is_dead_after(li_reg));
+        },
+        [](const Window& w) {
+            auto other { is_reg(w[1].get_operand(1), w[0].get_def()) ? w[1].get_operand(2) : w[1].get_operand(1) };
+            return std::vector<MachineInstr> {
+                MachineInstr(
+                    Opcode::Slli,
+                    { w[1].get_operand(0), other, get_log2(w[0].get_operand(1).get_imm()) }
+                )
+            };
+        }
+    },
+    {
+        // li t0, 1; mv a0, t0  =>  li a0, 1, if t0 is dead then
+        "fold-mv", 2,
+        [](const Window& w) {
+            if (w[1].get_opcode() != Opcode::Mv || !w[0].has_def()) return false;
+
+            auto reg { w[0].get_def() };
+            return is_reg(w[1].get_operand(1), reg) && !is_same_reg(w[1].get_def(), reg)
+                && w.is_dead_after(reg);
+        },
+        [](const Window& w) {
+            auto res { w[0] };
+            res.get_operand(0) = w[1].get_operand(0);
+            return std::vector<MachineInstr> { res };
+        }
+    },
+};
+static constexpr int RULE_N { sizeof(rules) / sizeof(rules[0]) };
+
+static int rule_counts[RULE_N] {};
+static int jump_next_count { 0 };
+
+static void run_peephole_on_block(MachineBasicBlock& block) {
+    auto& instrs { block.get_instrs() };
+
+    auto done { std::vector<MachineInstr>() };
+    done.reserve(instrs.size());
+
+    for (int i { 0 }; i < instrs.size(); i++) {
+        done.push_back(instrs[i]);
+
+        bool is_changed { true };
+        while (is_changed) {
+            is_changed = false;
+
+            for (int r { 0 }; r < RULE_N && !is_changed; r++) {
+                auto indexes { std::vector<int>() };
+                for (int j { static_cast<int>(done.size()) - 1 }; j >= 0 && indexes.size() < rules[r].size; j--) {
+                    if (done[j].get_opcode() != Opcode::Comment) {
+                        indexes.insert(indexes.begin(), j);
+                    }
+                }
+                if (indexes.size() < rules[r].size) continue;
+
+                Window window { done, indexes, instrs, i + 1 };
+                if (!rules[r].match(window)) continue;
+
+                auto replacement { rules[r].rewrite(window) };
+                for (int k { static_cast<int>(indexes.size()) - 1 }; k >= 0; k--) {
+                    done.erase(done.begin() + indexes[k]);
+                }
+                done.insert(done.end(), replacement.begin(), replacement.end());
+
+                rule_counts[r]++;
+                is_changed = true;
+            }
+        }
+    }
+
+    instrs = std::move(done);
+}
+
+void run_peephole(MachineFunction& func) {
+    auto& blocks { func.get_blocks() };
+
+    for (auto& block: blocks) {
+        run_peephole_on_block(block);
+    }
+
+    // j to the block laid out right after
+    for (int i { 0 }; i + 1 < blocks.size(); i++) {
+        auto& instrs { blocks[i].get_instrs() };
+
+        int last { static_cast<int>(instrs.size()) - 1 };
+        while (last >= 0 && instrs[last].get_opcode() == Opcode::Comment) last--;
+
+        if (last >= 0 && instrs[last].get_opcode() == Opcode::J
+            && instrs[last].get_operand(0).get_symbol() == blocks[i + 1].get_label()) {
+            instrs.erase(instrs.begin() + last);
+            jump_next_count++;
+        }
+    }
+}
+
+void report_peephole_counts() {
+    for (int r { 0 }; r < RULE_N; r++) {
+        std::cerr << "peephole: " << rules[r].name << ' ' << rule_counts[r] << std::endl;
+    }
+    std::cerr << "peephole: jump-next " << jump_next_count << std::endl;
+}
+
+}
@@ -1,4 +1,5 @@
 #include "riscv_trans.h"
+#include "machine_ir.h"
 #include "compiler_exception.hpp"
 
 #include "name.h"
@@ -22,8 +23,21 @@ namespace riscv_trans {
 
     int current_stack_frame_size { 0 };
     bool current_has_called_func { false };
-
-    Register RiscvStorage::get_addr(std::string& str) {
+    std::vector<Register> current_saved_regs;
+    std::unordered_set<const koopa::Id*> current_folded_ids;
+    std::unordered_set<const koopa::Stmt*> current_tail_calls;
+    bool enable_tail_call { true };
+    std::unordered_map<const koopa::FuncCall*, std::vector<const koopa::Id*>> current_call_saved_ids;
+    std::unordered_map<const koopa::Id*, int> current_save_slots;
+    int current_anchor_offset { 0 };
+    bool enable_frame_anchor { true };
+    bool enable_zba { false };
+    bool enable_zbb { false };
+    bool enable_rvc { false };
+
+    RegAllocStrategy reg_alloc_strategy { RegAllocStrategy::Naive };
+
+    Register RiscvStorage::get_addr(MachineBasicBlock& mbb) {
         assert(0);
         return Register();
     }
@@ -46,45 +60,57 @@ namespace riscv_trans {
         throw compiler_exception("unknown register `" + lit + '`');
     }
 
-    Register Register::get(std::string& str) { 
-        auto target_reg { temp_reg_manager.get_unused_reg() };
-
-        str += build_inst("mv", target_reg.get_lit(), get_lit()); 
-
-        return target_reg;
-
+    /*
+     * the register is read in place, so users of `get` must not write to the
+     * register returned
+     */
+    Register Register::get(MachineBasicBlock& mbb) { 
+        return *this;
     }
 
-    void Register::save(std::string& str, Register source_reg) {
-        str += build_inst("mv", get_lit(), source_reg.get_lit());
+    void Register::save(MachineBasicBlock& mbb, Register source_reg) {
+        if (source_reg.serial_num == serial_num) return;
+
+        mbb += MachineInstr(Opcode::Mv, { *this, source_reg });
     }
 
     std::string Register::get_lit() { return abi_name[serial_num]; }
 
     int Register::get_serial_num() { return serial_num; }
 
+    bool Register::is_callee_saved() {
+        auto lit { get_lit() };
+        return lit.at(0) == 's' && lit != "sp" && lit != "s0";
+    }
+
+    bool Register::is_compressible() {
+        auto lit { get_lit() };
+        return lit == "s0" || lit == "fp" || lit == "s1" 
+            || (lit.at(0) == 'a' && lit.at(1) >= '0' && lit.at(1) <= '5');
+    }
+
 
     DataSeg::DataSeg() : lit("") {}
     DataSeg::DataSeg(std::string lit): lit(lit) {}
 
-    Register DataSeg::get(std::string& str) { 
-        return get_addr(str);
+    Register DataSeg::get(MachineBasicBlock& mbb) { 
+        return get_addr(mbb);
     }
 
-    void DataSeg::save(std::string& str, Register source_reg) {
-        auto addr_reg { get_addr(str) };
+    void DataSeg::save(MachineBasicBlock& mbb, Register source_reg) {
+        auto addr_reg { get_addr(mbb) };
         
-        str += build_sw_lw("sw", source_reg, 0, addr_reg);
+        mbb += build_sw_lw(Opcode::Sw, source_reg, 0, addr_reg);
 
         temp_reg_manager.refresh_reg(addr_reg);
     }
 
-    Register DataSeg::get_addr(std::string& str) {
+    Register DataSeg::get_addr(MachineBasicBlock& mbb) {
         auto target_reg { temp_reg_manager.get_unused_reg() };
 
         // 32-bit compiler, la is enough
         // in 64-bit case, we need %hi and %lo
-        str += build_inst("la", target_reg.get_lit(), get_lit());
+        mbb += MachineInstr(Opcode::La, { target_reg, get_lit() });
         
         return target_reg;
     }
@@ -95,26 +121,65 @@ namespace riscv_trans {
     StackFrame::StackFrame(): offset(0) {}
     StackFrame::StackFrame(int offset): offset(offset) {}
 
-    Register StackFrame::get(std::string& str) { 
+    Register StackFrame::get(MachineBasicBlock& mbb) { 
         auto target_reg { temp_reg_manager.get_unused_reg() };
         
-        str += build_sw_lw("lw", target_reg, offset);
+        int base_offset { offset };
+        auto base_reg { get_frame_base(base_offset) };
+        mbb += build_sw_lw(Opcode::Lw, target_reg, base_offset, base_reg);
 
         return target_reg;
     }
 
-    void StackFrame::save(std::string& str, Register source_reg) {
-        str += build_sw_lw("sw", source_reg, offset);
+    void StackFrame::save(MachineBasicBlock& mbb, Register source_reg) {
+        int base_offset { offset };
+        auto base_reg { get_frame_base(base_offset) };
+        mbb += build_sw_lw(Opcode::Sw, source_reg, base_offset, base_reg);
     }
 
-    Register StackFrame::get_addr(std::string& str) {
+    Register StackFrame::get_addr(MachineBasicBlock& mbb) {
         auto target_reg { temp_reg_manager.get_unused_reg() };
 
-        str += build_i_type_inst("add", target_reg, Register("sp"), offset);
+        int base_offset { offset };
+        auto base_reg { get_frame_base(base_offset) };
+        mbb += build_i_type_inst(Opcode::Add, target_reg, base_reg, base_offset);
 
         return target_reg;
     }
 
+    int StackFrame::get_offset() { return offset; }
+
+    void set_target_arch(std::string march) {
+        auto base { march.substr(0, march.find('_')) };
+        if (base != "rv32im" && base != "rv32imc") {
+            throw compiler_exception("unsupported architecture `" + march + '`');
+        }
+
+        enable_rvc = base == "rv32imc";
+        enable_zba = enable_zbb = false;
+        for (auto begin { march.find('_') }; begin != std::string::npos; ) {
+            auto end { march.find('_', begin + 1) };
+            auto extension { march.substr(begin + 1, end == std::string::npos ? end : end - begin - 1) };
+
+            if (extension == "zba") enable_zba = true;
+            else if (extension == "zbb") enable_zbb = true;
+            else throw compiler_exception("unsupported extension `" + extension + '`');
+
+            begin = end;
+        }
+    }
+
+    Register get_frame_base(int& offset) {
+        if (
+            current_anchor_offset != 0 && !is_within_imm12_range(offset)
+            && is_within_imm12_range(offset - current_anchor_offset)
+        ) {
+            offset -= current_anchor_offset;
+            return Register("fp");
+        }
+        return Register("sp");
+    }
+
     TempRegManager::TempRegManager() {
         for (int i { 0 }; i < TEMP_REG_COUNT; i++) {
             is_used[i] = false;
@@ -133,11 +198,16 @@ namespace riscv_trans {
     }
 
     void TempRegManager::refresh_reg(Register reg) {
-        auto lit { reg.get_lit() };
+        if (!is_temp_reg(reg)) return;
 
-        if (lit.at(0) != 't') return;
+        is_used[reg.get_lit().at(1) - '0'] = false;
+    }
+
+    bool TempRegManager::is_temp_reg(Register reg) {
+        auto lit { reg.get_lit() };
 
-        is_used[lit.at(1) - '0'] = false;
+        // t3-t6 are allocated by register allocator
+        return lit.at(0) == 't' && lit.at(1) - '0' < TEMP_REG_COUNT;
     }
 
     IdStorageMap::IdStorageMap() {}
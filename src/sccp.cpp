@@ -0,0 +1,466 @@
+#include "sccp.h"
+#include "cfg.h"
+#include "value_manager.h"
+
+#include <climits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace koopa_opt {
+
+bool enable_sccp { true };
+
+struct Lattice {
+    enum class State { Undefined, Constant, Overdefined };
+
+    State state;
+    int val;
+
+    bool operator!=(const Lattice& other) const {
+        return state != other.state || (state == State::Constant && val != other.val);
+    }
+};
+
+static const Lattice undefined { Lattice::State::Undefined, 0 };
+static const Lattice overdefined { Lattice::State::Overdefined, 0 };
+
+static Lattice meet(Lattice a, Lattice b) {
+    if (a.state == Lattice::State::Undefined) return b;
+    if (b.state == Lattice::State::Undefined) return a;
+    if (a.state == Lattice::State::Overdefined || b.state == Lattice::State::Overdefined) return overdefined;
+    return a.val == b.val ? a : overdefined;
+}
+
+/**
+ * @param res  set to `lv` op `rv` as the machine computes it
+ * @return  whether it is known at compile time, false for a division by zero
+ */
+static bool fold(const koopa::Expr* expr, int lv, int rv, int& res) {
+    auto ulv { static_cast<unsigned>(lv) }, urv { static_cast<unsigned>(rv) };
+
+    if (dynamic_cast<const koopa::Eq*>(expr)) res = lv == rv;
+    else if (dynamic_cast<const koopa::Ne*>(expr)) res = lv != rv;
+    else if (dynamic_cast<const koopa::Gt*>(expr)) res = lv > rv;
+    else if (dynamic_cast<const koopa::Lt*>(expr)) res = lv < rv;
+    else if (dynamic_cast<const koopa::Ge*>(expr)) res = lv >= rv;
+    else if (dynamic_cast<const koopa::Le*>(expr)) res = lv <= rv;
+    else if (dynamic_cast<const koopa::Add*>(expr)) res = static_cast<int>(ulv + urv);
+    else if (dynamic_cast<const koopa::Sub*>(expr)) res = static_cast<int>(ulv - urv);
+    else if (dynamic_cast<const koopa::Mul*>(expr)) res = static_cast<int>(ulv * urv);
+    else if (dynamic_cast<const koopa::Div*>(expr)) {
+        if (rv == 0) return false;
+        // `div` overflows to the dividend
+        res = lv == INT_MIN && rv == -1 ? INT_MIN : lv / rv;
+    }
+    else if (dynamic_cast<const koopa::Mod*>(expr)) {
+        if (rv == 0) return false;
+        res = lv == INT_MIN && rv == -1 ? 0 : lv % rv;
+    }
+    else if (dynamic_cast<const koopa::And*>(expr)) res = lv & rv;
+    else if (dynamic_cast<const koopa::Or*>(expr)) res = lv | rv;
+    else if (dynamic_cast<const koopa::Xor*>(expr)) res = lv ^ rv;
+    else if (dynamic_cast<const koopa::Shl*>(expr)) res = static_cast<int>(ulv << (urv & 31));
+    else if (dynamic_cast<const koopa::Shr*>(expr)) res = static_cast<int>(ulv >> (urv & 31));
+    else if (dynamic_cast<const koopa::Sar*>(expr)) res = lv >> (urv & 31);
+    else return false;
+
+    return true;
+}
+
+/*
+ * the lattice values of a function, solved from its entry with a worklist
+ * of the edges newly found taken and one of the values newly lowered
+ */
+class Solver {
+public:
+    Solver(const dataflow::Cfg& cfg);
+
+    void solve();
+
+    Lattice get_value(koopa::Value* value) const;
+    bool is_executable(int block) const;
+    /**
+     * @return  targets of `block` its terminator may take, by the index of
+     *          `get_target_labels`
+     */
+    const std::vector<bool>& get_executable_edges(int block) const;
+
+private:
+    const dataflow::Cfg& cfg;
+
+    // the values tracked, i.e. defined by an expression or an `i32` parameter
+    std::unordered_map<koopa::Id*, Lattice> values;
+    // statements reading each value, with their block
+    std::unordered_map<koopa::Id*, std::vector<std::pair<int, koopa::Stmt*>>> users;
+
+    // for each block, the index of the block each target of its terminator is
+    std::vector<std::vector<int>> targets;
+    // for each block, the edges into it, as a block and an index of its targets
+    std::vector<std::vector<std::pair<int, int>>> in_edges;
+
+    std::vector<bool> executable_blocks;
+    std::vector<std::vector<bool>> executable_edges;
+
+    std::vector<std::pair<int, int>> edge_worklist;
+    std::vector<koopa::Id*> value_worklist;
+
+    void set_value(koopa::Id* id, Lattice value);
+    void visit_params(int block);
+    void visit(int block, koopa::Stmt* stmt);
+};
+
+Solver::Solver(const dataflow::Cfg& cfg): cfg(cfg) {
+    int block_n { cfg.get_block_n() };
+    targets.resize(block_n);
+    in_edges.resize(block_n);
+    executable_blocks.assign(block_n, false);
+    executable_edges.resize(block_n);
+
+    for (int i { 0 }; i < block_n; i++) {
+        auto* block { cfg.get_block(i) };
+
+        for (auto* param: block->get_params()) {
+            if (param->get_type()->get_type_id() == koopa::Type::TypeId::Int) {
+                values.emplace(param, undefined);
+            }
+        }
+
+        for (auto* stmt: block->get_stmts()) {
+            auto* symbol_def { dynamic_cast<koopa::SymbolDef*>(stmt) };
+            if (symbol_def != nullptr && dynamic_cast<koopa::Expr*>(symbol_def->get_val())) {
+                values.emplace(symbol_def->get_def_id(), undefined);
+            }
+
+            for (auto* id: stmt->get_used_ids()) {
+                auto& id_users { users[id] };
+                if (id_users.empty() || id_users.back().second != stmt) {
+                    id_users.push_back({ i, stmt });
+                }
+            }
+        }
+
+        // in the order of `get_target_labels`
+        targets[i] = cfg.get_succs(i);
+        executable_edges[i].assign(targets[i].size(), false);
+    }
+
+    // `cfg.get_preds`, each along with its index among the targets of its
+    // source, which tells the edges of a `br` to one block both ways apart
+    for (int i { 0 }; i < block_n; i++) {
+        for (int k { 0 }; k < targets[i].size(); k++) {
+            in_edges[targets[i][k]].push_back({ i, k });
+        }
+    }
+}
+
+Lattice Solver::get_value(koopa::Value* value) const {
+    if (value->is_const()) return { Lattice::State::Constant, value->get_val() };
+
+    auto* id { dynamic_cast<koopa::Id*>(value) };
+    auto it { id ? values.find(id) : values.end() };
+    return it != values.end() ? it->second : overdefined;
+}
+
+bool Solver::is_executable(int block) const { return executable_blocks[block]; }
+
+const std::vector<bool>& Solver::get_executable_edges(int block) const {
+    return executable_edges[block];
+}
+
+void Solver::set_value(koopa::Id* id, Lattice value) {
+    auto& old_value { values.at(id) };
+    if (old_value != value) {
+        old_value = value;
+        value_worklist.push_back(id);
+    }
+}
+
+void Solver::visit_params(int block) {
+    auto& params { cfg.get_block(block)->get_params() };
+
+    for (int j { 0 }; j < params.size(); j++) {
+        if (values.count(params[j]) == 0) continue;
+
+        auto value { undefined };
+        for (auto [pred, k]: in_edges[block]) {
+            if (!executable_edges[pred][k]) continue;
+
+            auto* terminator { cfg.get_block(pred)->get_stmts().back() };
+            auto* jump { dynamic_cast<koopa::Jump*>(terminator) };
+            auto args { jump ? jump->get_args() : dynamic_cast<koopa::Branch*>(terminator)->get_target_args(k) };
+            value = meet(value, get_value(args[j]));
+        }
+        set_value(params[j], value);
+    }
+}
+
+void Solver::visit(int block, koopa::Stmt* stmt) {
+    if (auto* symbol_def { dynamic_cast<koopa::SymbolDef*>(stmt) }) {
+        auto* expr { dynamic_cast<koopa::Expr*>(symbol_def->get_val()) };
+        if (expr == nullptr) return;
+
+        auto lv { get_value(expr->get_lv()) }, rv { get_value(expr->get_rv()) };
+        if (lv.state == Lattice::State::Undefined || rv.state == Lattice::State::Undefined) return;
+
+        int res;
+        if (lv.state == Lattice::State::Constant && rv.state == Lattice::State::Constant
+            && fold(expr, lv.val, rv.val, res)) {
+            set_value(symbol_def->get_def_id(), { Lattice::State::Constant, res });
+        }
+        else {
+            set_value(symbol_def->get_def_id(), overdefined);
+        }
+        return;
+    }
+
+    auto taken { std::vector<int>() };
+    if (dynamic_cast<koopa::Jump*>(stmt)) {
+        taken.push_back(0);
+    }
+    else if (auto* branch { dynamic_cast<koopa::Branch*>(stmt) }) {
+        auto cond { get_value(branch->get_cond()) };
+        if (cond.state == Lattice::State::Constant) taken.push_back(cond.val != 0 ? 0 : 1);
+        else if (cond.state == Lattice::State::Overdefined) taken = { 0, 1 };
+    }
+
+    for (int k: taken) {
+        if (executable_edges[block][k]) {
+            // the arguments may have changed
+            visit_params(targets[block][k]);
+        }
+        else {
+            edge_worklist.push_back({ block, k });
+        }
+    }
+}
+
+void Solver::solve() {
+    if (cfg.get_block_n() == 0) return;
+
+    executable_blocks[0] = true;
+    for (auto* stmt: cfg.get_block(0)->get_stmts()) {
+        visit(0, stmt);
+    }
+
+    while (!edge_worklist.empty() || !value_worklist.empty()) {
+        while (!edge_worklist.empty()) {
+            auto [block, k] = edge_worklist.back();
+            edge_worklist.pop_back();
+            if (executable_edges[block][k]) continue;
+
+            executable_edges[block][k] = true;
+            int target { targets[block][k] };
+            visit_params(target);
+
+            if (!executable_blocks[target]) {
+                executable_blocks[target] = true;
+                for (auto* stmt: cfg.get_block(target)->get_stmts()) {
+                    visit(target, stmt);
+                }
+            }
+        }
+
+        while (!value_worklist.empty()) {
+            auto* id { value_worklist.back() };
+            value_worklist.pop_back();
+
+            auto it { users.find(id) };
+            if (it == users.end()) continue;
+            for (auto [block, stmt]: it->second) {
+                if (executable_blocks[block]) visit(block, stmt);
+            }
+        }
+    }
+}
+
+/*
+ * replaces the parameters of each block reached along a single edge by the
+ * arguments passed along it, then merges into a block ending in a `jump` the
+ * block it jumps to when that has no other predecessor, e.g. the blocks left
+ * in a row of an `if` whose condition was constant
+ *
+ * @return  whether `func_def` changed
+ */
+static bool simplify_cfg(koopa::FuncDef* func_def) {
+    auto& cfg { dataflow::get_cfg(func_def) };
+    int block_n { cfg.get_block_n() };
+
+    auto is_single_edge = [&](int block) {
+        auto& preds { cfg.get_preds(block) };
+        return block != 0 && preds.size() == 1 && preds[0] != block;
+    };
+
+    auto params { std::unordered_map<koopa::Id*, koopa::Value*>() };
+    for (int i { 1 }; i < block_n; i++) {
+        auto* block { cfg.get_block(i) };
+        if (!is_single_edge(i) || block->get_params().empty()) continue;
+
+        int pred { cfg.get_preds(i)[0] };
+        auto* terminator { cfg.get_block(pred)->get_stmts().back() };
+        auto args { std::vector<koopa::Value*>() };
+        if (auto* jump { dynamic_cast<koopa::Jump*>(terminator) }) {
+            args = jump->get_args();
+            jump->set_args({});
+        }
+        else if (auto* branch { dynamic_cast<koopa::Branch*>(terminator) }) {
+            int k { cfg.get_succs(pred)[0] == i ? 0 : 1 };
+            args = branch->get_target_args(k);
+            branch->set_target_args(k, {});
+        }
+
+        for (int j { 0 }; j < args.size(); j++) {
+            params[block->get_params()[j]] = args[j];
+        }
+        block->get_params().clear();
+    }
+
+    // an argument may be a parameter replaced as well, the edges replaced
+    // form no cycle among the blocks reached
+    for (auto& [param, arg]: params) {
+        auto* id { dynamic_cast<koopa::Id*>(arg) };
+        while (id != nullptr && params.count(id) != 0) {
+            arg = params.at(id);
+            id = dynamic_cast<koopa::Id*>(arg);
+        }
+    }
+    if (!params.empty()) {
+        for (int i { 0 }; i < block_n; i++) {
+            for (auto* stmt: cfg.get_block(i)->get_stmts()) {
+                stmt->replace_uses(params);
+            }
+        }
+    }
+
+    // `tails[i]` is the block whose terminator ends block `i` by now
+    auto tails { std::vector<int>(block_n) };
+    auto is_merged { std::vector<bool>(block_n, false) };
+    for (int i { 0 }; i < block_n; i++) tails[i] = i;
+
+    bool is_changed { !params.empty() };
+    for (int i { 0 }; i < block_n; i++) {
+        if (is_merged[i]) continue;
+
+        auto& stmts { cfg.get_block(i)->get_stmts() };
+        while (dynamic_cast<koopa::Jump*>(stmts.back()) != nullptr) {
+            int succ { cfg.get_succs(tails[i])[0] };
+            if (!is_single_edge(succ) || succ == i || is_merged[succ]) break;
+
+            auto& succ_stmts { cfg.get_block(succ)->get_stmts() };
+            stmts.pop_back();
+            stmts.insert(stmts.end(), succ_stmts.begin(), succ_stmts.end());
+            is_merged[succ] = true;
+            tails[i] = tails[succ];
+            is_changed = true;
+        }
+    }
+
+    if (is_changed) {
+        auto blocks { std::vector<koopa::Block*>() };
+        for (int i { 0 }; i < block_n; i++) {
+            if (!is_merged[i]) blocks.push_back(cfg.get_block(i));
+        }
+        func_def->set_blocks(blocks);
+        dataflow::invalidate_cfg(func_def);
+    }
+    return is_changed;
+}
+
+bool sccp(koopa::FuncDef* func_def) {
+    auto& cfg { dataflow::get_cfg(func_def) };
+    Solver solver(cfg);
+    solver.solve();
+
+    // the constants replacing the values, and the parameters to remove
+    auto consts { std::unordered_map<koopa::Id*, koopa::Value*>() };
+    std::vector<std::vector<bool>> removed_params(cfg.get_block_n());
+    bool is_changed { false };
+
+    auto get_const = [&](koopa::Id* id) -> koopa::Value* {
+        auto value { solver.get_value(id) };
+        if (value.state != Lattice::State::Constant || id->is_const()) return nullptr;
+        return consts[id] = value_manager.new_const(value.val);
+    };
+
+    for (int i { 0 }; i < cfg.get_block_n(); i++) {
+        auto* block { cfg.get_block(i) };
+        auto& params { block->get_params() };
+        removed_params[i].assign(params.size(), false);
+        if (!solver.is_executable(i)) continue;
+
+        for (int j { 0 }; j < params.size(); j++) {
+            removed_params[i][j] = get_const(params[j]) != nullptr;
+        }
+
+        for (auto* stmt: block->get_stmts()) {
+            if (auto* def_id { stmt->get_def_id() }) {
+                get_const(def_id);
+            }
+        }
+    }
+
+    for (int i { 0 }; i < cfg.get_block_n(); i++) {
+        if (!solver.is_executable(i)) continue;
+        auto* block { cfg.get_block(i) };
+
+        auto stmts { std::vector<koopa::Stmt*>() };
+        for (auto* stmt: block->get_stmts()) {
+            auto* def_id { stmt->get_def_id() };
+            if (def_id != nullptr && consts.count(def_id) != 0) {
+                is_changed = true;
+                continue;
+            }
+
+            stmt->replace_uses(consts);
+            stmts.push_back(stmt);
+        }
+
+        auto* terminator { stmts.back() };
+        auto remove_args = [&](int target, std::vector<koopa::Value*> args) {
+            auto res { std::vector<koopa::Value*>() };
+            for (int j { 0 }; j < args.size(); j++) {
+                if (!removed_params[target][j]) res.push_back(args[j]);
+            }
+            return res;
+        };
+
+        auto& succs { cfg.get_succs(i) };
+        auto& executable_edges { solver.get_executable_edges(i) };
+        if (auto* jump { dynamic_cast<koopa::Jump*>(terminator) }) {
+            jump->set_args(remove_args(succs[0], jump->get_args()));
+        }
+        else if (auto* branch { dynamic_cast<koopa::Branch*>(terminator) }) {
+            if (executable_edges[0] != executable_edges[1]) {
+                int k { executable_edges[0] ? 0 : 1 };
+                stmts.back() = new koopa::Jump(
+                    branch->get_target_labels()[k],
+                    remove_args(succs[k], branch->get_target_args(k))
+                );
+                is_changed = true;
+            }
+            else {
+                for (int k { 0 }; k < 2; k++) {
+                    branch->set_target_args(k, remove_args(succs[k], branch->get_target_args(k)));
+                }
+            }
+        }
+
+        block->get_stmts() = std::move(stmts);
+
+        auto params { std::vector<koopa::Id*>() };
+        for (int j { 0 }; j < block->get_params().size(); j++) {
+            if (!removed_params[i][j]) params.push_back(block->get_params()[j]);
+        }
+        block->get_params() = std::move(params);
+    }
+
+    if (is_changed || !consts.empty()) {
+        dataflow::invalidate_cfg(func_def);
+        dataflow::remove_unreachable_blocks(func_def);
+        simplify_cfg(func_def);
+        return true;
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,325 @@
+#include "strength_reduction.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace riscv_trans {
+
+using Instrs = std::vector<MachineInstr>;
+
+int get_cost(const Instrs& instrs) {
+    int res { 0 };
+    for (auto& instr: instrs) {
+        switch (instr.get_opcode()) {
+            case Opcode::Mul: case Opcode::Mulh:
+                res += MUL_COST;
+                break;
+            case Opcode::Div: case Opcode::Rem:
+                res += DIV_COST;
+                break;
+            case Opcode::Li:
+                res += is_within_imm12_range(instr.get_operand(1).get_imm()) ? 1 : 2;
+                break;
+            case Opcode::Comment:
+                break;
+            default:
+                res += 1;
+                break;
+        }
+    }
+    return res;
+}
+
+static void emit_cheapest(MachineBasicBlock& mbb, std::vector<Instrs> candidates) {
+    int best { 0 };
+    for (int i { 1 }; i < candidates.size(); i++) {
+        if (get_cost(candidates[i]) < get_cost(candidates[best])) {
+            best = i;
+        }
+    }
+    mbb += candidates[best];
+}
+
+int get_log2(unsigned x) {
+    if (x == 0 || (x & (x - 1)) != 0) return -1;
+
+    int res { 0 };
+    while (x >>= 1) res++;
+    return res;
+}
+
+Opcode get_sh_add_opcode(int stride) {
+    switch (stride) {
+        case 2: return Opcode::Sh1add;
+        case 4: return Opcode::Sh2add;
+        case 8: return Opcode::Sh3add;
+        default: return Opcode::Add;
+    }
+}
+
+static const Register zero { "zero" };
+
+/*
+ * `li tmp, val; <opcode> target, source, tmp`
+ */
+static Instrs build_plain(Opcode opcode, Register target, Register source, Register tmp, int val) {
+    return {
+        MachineInstr(Opcode::Li, { tmp, val }),
+        MachineInstr(opcode, { target, source, tmp })
+    };
+}
+
+/*
+ * `target = source * val` in Horner's form over the non-adjacent form of
+ * `|val|`, each non-zero digit but the first costing a shift and an add or sub
+ */
+static Instrs build_shift_add(Register target, Register source, int val) {
+    if (val == 0) {
+        return { MachineInstr(Opcode::Li, { target, 0 }) };
+    }
+
+    // digits from the lowest, `(position, sign)`
+    auto digits { std::vector<std::pair<int, int>>() };
+    uint64_t n { static_cast<uint64_t>(val < 0 ? -static_cast<int64_t>(val) : val) };
+    for (int pos { 0 }; n != 0; pos++, n >>= 1) {
+        if (n & 1) {
+            int sign { (n & 3) == 3 ? -1 : 1 };
+            digits.push_back({ pos, sign });
+            n -= sign;
+        }
+    }
+
+    auto res { Instrs() };
+    int top { static_cast<int>(digits.size()) - 1 };
+    if (top == 0) {
+        res.push_back(MachineInstr(Opcode::Slli, { target, source, digits[0].first }));
+    }
+    else {
+        res.push_back(MachineInstr(Opcode::Slli, { target, source, digits[top].first - digits[top - 1].first }));
+        for (int i { top - 1 }; i >= 0; i--) {
+            res.push_back(MachineInstr(digits[i].second > 0 ? Opcode::Add : Opcode::Sub, { target, target, source }));
+            int shift { i > 0 ? digits[i].first - digits[i - 1].first : digits[i].first };
+            if (shift > 0) {
+                res.push_back(MachineInstr(Opcode::Slli, { target, target, shift }));
+            }
+        }
+    }
+
+    if (val < 0) {
+        res.push_back(MachineInstr(Opcode::Sub, { target, zero, target }));
+    }
+
+    return res;
+}
+
+/*
+ * `target = source * val` with Zba, `val` factored into 3, 5 and 9, each one
+ * `shNadd` of the product so far to itself, and a power of 2 shifted in last.
+ * empty if `val` has another factor
+ */
+static Instrs build_sh_add(Register target, Register source, int val) {
+    if (val <= 0) return {};
+
+    int k { 0 };
+    while (val % 2 == 0) {
+        val /= 2;
+        k++;
+    }
+
+    auto res { Instrs() };
+    auto factor_reg { source };
+    for (int factor: { 9, 5, 3 }) {
+        while (val % factor == 0) {
+            val /= factor;
+            res.push_back(MachineInstr(get_sh_add_opcode(factor - 1), { target, factor_reg, factor_reg }));
+            factor_reg = target;
+        }
+    }
+    if (val != 1) return {};
+
+    if (k > 0) {
+        res.push_back(MachineInstr(Opcode::Slli, { target, factor_reg, k }));
+    }
+    return res;
+}
+
+bool sh_add_mul_to_riscv(MachineBasicBlock& mbb, Register target, Register source, int val) {
+    auto instrs { build_sh_add(target, source, val) };
+    if (instrs.empty()) return false;
+
+    mbb += instrs;
+    return true;
+}
+
+void mul_by_const_to_riscv(MachineBasicBlock& mbb, Register target, Register source, int val) {
+    auto tmp { temp_reg_manager.get_unused_reg() };
+
+    auto candidates { std::vector<Instrs> {
+        build_plain(Opcode::Mul, target, source, tmp, val),
+        build_shift_add(target, source, val)
+    } };
+    if (enable_zba) {
+        auto candidate { build_sh_add(target, source, val) };
+        if (!candidate.empty()) {
+            candidates.push_back(candidate);
+        }
+    }
+
+    emit_cheapest(mbb, candidates);
+
+    temp_reg_manager.refresh_reg(tmp);
+}
+
+/*
+ * `target = source < 0 ? 2^k - 1 : 0`, added to a negative dividend so that
+ * the shift rounds toward zero
+ */
+static Instrs build_bias(Register target, Register source, int k) {
+    if (k == 1) {
+        return { MachineInstr(Opcode::Srli, { target, source, 31 }) };
+    }
+    return {
+        MachineInstr(Opcode::Srai, { target, source, 31 }),
+        MachineInstr(Opcode::Srli, { target, target, 32 - k })
+    };
+}
+
+/*
+ * `target = source / 2^k`, `k` in 1..30
+ */
+static Instrs build_div_pow2(Register target, Register source, int k) {
+    auto res { build_bias(target, source, k) };
+    res.push_back(MachineInstr(Opcode::Add, { target, target, source }));
+    res.push_back(MachineInstr(Opcode::Srai, { target, target, k }));
+    return res;
+}
+
+/*
+ * `M` and `s` such that `x / d == (mulh(x, M) [+ x if M < 0]) >> s` rounded
+ * toward zero for every `x`, by Hacker's Delight 10-4
+ *
+ * @param d  in 2..2^31-1
+ */
+static std::pair<int, int> get_magic(int d) {
+    const uint32_t two31 { 0x80000000 };
+    uint32_t ad { static_cast<uint32_t>(d) };
+    uint32_t anc { two31 - 1 - two31 % ad };
+    int p { 31 };
+    uint32_t q1 { two31 / anc }, r1 { two31 - q1 * anc };
+    uint32_t q2 { two31 / ad }, r2 { two31 - q2 * ad };
+    uint32_t delta;
+
+    do {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) { q1++; r1 -= anc; }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad) { q2++; r2 -= ad; }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    return { static_cast<int>(q2 + 1), p - 32 };
+}
+
+/*
+ * `target = source / d` by the magic number of `d`, plus one for a negative
+ * quotient to round toward zero
+ *
+ * @param d  in 2..2^31-1
+ */
+static Instrs build_div_magic(Register target, Register source, Register tmp, int d) {
+    auto [magic, shift] { get_magic(d) };
+
+    auto res { Instrs {
+        MachineInstr(Opcode::Li, { target, magic }),
+        MachineInstr(Opcode::Mulh, { target, source, target })
+    } };
+    if (magic < 0) {
+        res.push_back(MachineInstr(Opcode::Add, { target, target, source }));
+    }
+    if (shift > 0) {
+        res.push_back(MachineInstr(Opcode::Srai, { target, target, shift }));
+    }
+    res.push_back(MachineInstr(Opcode::Srli, { tmp, source, 31 }));
+    res.push_back(MachineInstr(Opcode::Add, { target, target, tmp }));
+    return res;
+}
+
+void div_by_const_to_riscv(MachineBasicBlock& mbb, Register target, Register source, int val) {
+    auto tmp { temp_reg_manager.get_unused_reg() };
+
+    auto candidates { std::vector<Instrs> { build_plain(Opcode::Div, target, source, tmp, val) } };
+
+    if (val == 1) {
+        candidates.push_back({ MachineInstr(Opcode::Mv, { target, source }) });
+    }
+    else if (val == -1) {
+        candidates.push_back({ MachineInstr(Opcode::Sub, { target, zero, source }) });
+    }
+    else if (val != 0 && val != INT32_MIN) {
+        int abs_val { val < 0 ? -val : val };
+        int k { get_log2(abs_val) };
+
+        auto candidate { k != -1 ? build_div_pow2(target, source, k) : build_div_magic(target, source, tmp, abs_val) };
+        if (val < 0) {
+            candidate.push_back(MachineInstr(Opcode::Sub, { target, zero, target }));
+        }
+        candidates.push_back(candidate);
+    }
+
+    emit_cheapest(mbb, candidates);
+
+    temp_reg_manager.refresh_reg(tmp);
+}
+
+/*
+ * `target = source % 2^k`, as `source` minus itself rounded toward zero to a
+ * multiple of `2^k`
+ */
+static Instrs build_rem_pow2(Register target, Register source, Register tmp, int k) {
+    auto res { build_bias(tmp, source, k) };
+    res.push_back(MachineInstr(Opcode::Add, { target, source, tmp }));
+
+    if (is_within_imm12_range(-(int64_t(1) << k))) {
+        res.push_back(MachineInstr(Opcode::Andi, { target, target, -(1 << k) }));
+    }
+    else {
+        res.push_back(MachineInstr(Opcode::Srai, { target, target, k }));
+        res.push_back(MachineInstr(Opcode::Slli, { target, target, k }));
+    }
+
+    res.push_back(MachineInstr(Opcode::Sub, { target, source, target }));
+    return res;
+}
+
+void rem_by_const_to_riscv(MachineBasicBlock& mbb, Register target, Register source, int val) {
+    auto tmp { temp_reg_manager.get_unused_reg() };
+
+    auto candidates { std::vector<Instrs> { build_plain(Opcode::Rem, target, source, tmp, val) } };
+
+    // the remainder takes the sign of the dividend, whatever that of the divisor
+    uint32_t abs_val { val < 0 ? -static_cast<uint32_t>(val) : static_cast<uint32_t>(val) };
+    int k { get_log2(abs_val) };
+
+    if (abs_val == 1) {
+        candidates.push_back({ MachineInstr(Opcode::Li, { target, 0 }) });
+    }
+    else if (k != -1) {
+        candidates.push_back(build_rem_pow2(target, source, tmp, k));
+    }
+    else if (abs_val != 0) {
+        auto candidate { build_div_magic(target, source, tmp, abs_val) };
+        candidate.push_back(MachineInstr(Opcode::Li, { tmp, static_cast<int>(abs_val) }));
+        candidate.push_back(MachineInstr(Opcode::Mul, { target, target, tmp }));
+        candidate.push_back(MachineInstr(Opcode::Sub, { target, source, target }));
+        candidates.push_back(candidate);
+    }
+
+    emit_cheapest(mbb, candidates);
+
+    temp_reg_manager.refresh_reg(tmp);
+}
+
+}
@@ -4,6 +4,7 @@
 
 import sys
 import os
+import subprocess
 
 class UnknownArgument(Exception):
     def __init__(self, argument):
@@ -12,7 +13,82 @@ class UnknownArgument(Exception):
     def __str__(self):
         return f"unknown argument `{self.argument}`"
 
+# allocators `regalloc` runs the testcases with, each at every level
+REGALLOCS = ["linear-scan", "graph-coloring"]
+OPT_LEVELS = ["-O0", "-O2"]
+
+TESTCASE_DIR = "./testcases/testcases"
+# those of the passes of `-O1` and `-O2`, as the stage `opt`
+OPT_TESTCASE_DIR = "./testcases/opt"
+REGALLOC_BUILD_DIR = "./build/regalloc"
+
+def run_testcase(case, flags):
+    """compiles, links and runs `case` as `make test-rvc` does, returns
+    whether its output followed by its return value is that of `case.out`"""
+    name = os.path.basename(case)
+    asm = f"{REGALLOC_BUILD_DIR}/{name}.S"
+    obj = f"{REGALLOC_BUILD_DIR}/{name}.o"
+    exe = f"{REGALLOC_BUILD_DIR}/{name}"
+    lib_dir = os.environ.get("CDE_LIBRARY_PATH", "") + "/riscv32"
+
+    commands = [
+        ["./build/compiler", "-riscv", f"{case}.c", "-o", asm] + flags,
+        ["clang", asm, "-c", "-o", obj, "-target", "riscv32-unknown-linux-elf",
+            "-march=rv32im", "-mabi=ilp32"],
+        ["ld.lld", obj, f"-L{lib_dir}", "-lsysy", "-o", exe],
+    ]
+    for command in commands:
+        if subprocess.run(command).returncode != 0:
+            return False
+
+    stdin = open(f"{case}.in") if os.path.exists(f"{case}.in") else subprocess.DEVNULL
+    result = subprocess.run(["qemu-riscv32-static", exe], stdin=stdin, capture_output=True, text=True)
+    output = result.stdout
+    if output and not output.endswith("\n"):
+        output += "\n"
+    output += f"{result.returncode}\n"
+
+    with open(f"{case}.out") as expected:
+        return output == expected.read()
+
+def run_regalloc_tests(stage):
+    """runs the testcases of `stage`, all if none, with each of `REGALLOCS`
+    at each of `OPT_LEVELS`"""
+    os.system("make")
+    os.makedirs(REGALLOC_BUILD_DIR, exist_ok=True)
+
+    if stage == "opt":
+        dirs = [OPT_TESTCASE_DIR]
+    elif stage and stage != "all":
+        dirs = [f"{TESTCASE_DIR}/{stage}"]
+    else:
+        dirs = [f"{TESTCASE_DIR}/{s}" for s in sorted(os.listdir(TESTCASE_DIR))] + [OPT_TESTCASE_DIR]
+    cases = [
+        f"{dir}/{file[:-2]}"
+        for dir in dirs
+        for file in sorted(os.listdir(dir))
+        if file.endswith(".c")
+    ]
+
+    failed_n = 0
+    for regalloc in REGALLOCS:
+        for opt_level in OPT_LEVELS:
+            flags = [f"-regalloc={regalloc}", opt_level]
+            for case in cases:
+                if not run_testcase(case, flags):
+                    print(f"FAILED {case} {' '.join(flags)}")
+                    failed_n += 1
+
+    total_n = len(REGALLOCS) * len(OPT_LEVELS) * len(cases)
+    print(f"{total_n - failed_n}/{total_n} passed")
+    return failed_n == 0
+
 def call_command(stage, target_lang, debug_flag):
+    if target_lang == "regalloc":
+        if not run_regalloc_tests(stage):
+            sys.exit(1)
+        return
+
     if target_lang == "":
         call_command(stage, "koopa", debug_flag)
         call_command(stage, "riscv", debug_flag)
@@ -40,9 +116,9 @@ def parse_arguments(args):
     debug_flag = []
     
     for arg in args:
-        if arg.startswith("lv") or arg == "perf" or arg == "hello" or arg == "all":
+        if arg.startswith("lv") or arg == "perf" or arg == "opt" or arg == "hello" or arg == "all":
             stage = arg
-        elif arg == "koopa" or arg == "riscv" or arg == "test":
+        elif arg == "koopa" or arg == "riscv" or arg == "test" or arg == "regalloc":
             target_lang = arg
         elif arg == "-dbg-k" or arg == "-dbg-r":
             debug_flag.append(arg)
@@ -0,0 +1,30 @@
+// locals reaching the loop header from `continue`, and the exit from `break`
+int main() {
+  int i = 0, s = 0, last = -1;
+  while (1) {
+    i = i + 1;
+    if (i % 3 == 0) continue;
+    if (i > 20) {
+      last = i;
+      break;
+    }
+    s = s + i;
+  }
+  putint(i); putch(10);
+  putint(s); putch(10);
+  putint(last); putch(10);
+
+  int n = 0, m = 0;
+  while (n < 10) {
+    n = n + 1;
+    int k = 0;
+    while (1) {
+      k = k + 1;
+      if (k == n) break;
+      if (k % 2) continue;
+      m = m + k;
+    }
+  }
+  putint(m); putch(10);
+  return m;
+}
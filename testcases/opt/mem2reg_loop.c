@@ -0,0 +1,28 @@
+// locals stored in a loop and read after it, passed to the loop header as
+// arguments, some of them swapped on each iteration
+int main() {
+  int a = 0, b = 1, i = 0, s = 0;
+  while (i < 20) {
+    int t = a + b;
+    a = b;
+    b = t;
+    s = s + a;
+    i = i + 1;
+  }
+  putint(a); putch(10);
+  putint(s); putch(10);
+
+  int x = 1, y = 2, j = 0;
+  while (j < 5) {
+    int k = 0;
+    while (k < j) {
+      int tmp = x;
+      x = y;
+      y = tmp;
+      k = k + 1;
+    }
+    j = j + 1;
+  }
+  putint(x * 10 + y); putch(10);
+  return s % 256;
+}
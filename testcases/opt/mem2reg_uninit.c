@@ -0,0 +1,26 @@
+// locals read before any store to them, on some paths or on all, with none
+// of the values SysY leaves undefined reaching the output
+int f(int c) {
+  int x;
+  if (c) x = 7;
+  if (c) return x;
+  return -1;
+}
+
+int main() {
+  int a;
+  int b = a * 0 + 1;
+
+  int i = 0, s;
+  while (i < 3) {
+    if (i == 0) s = 0;
+    s = s + i;
+    i = i + 1;
+  }
+
+  putint(b); putch(10);
+  putint(f(0)); putch(10);
+  putint(f(1)); putch(10);
+  putint(s); putch(10);
+  return 0;
+}
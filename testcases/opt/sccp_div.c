@@ -0,0 +1,13 @@
+// `INT_MIN / -1` folds to what the machine gives, and a division by zero is
+// left for the run time
+int main() {
+  int a = -2147483647 - 1;
+  int b = -1;
+  putint(a / b); putch(10);
+  putint(a % b); putch(10);
+
+  int d = 0;
+  putint(7 / d); putch(10);
+  putint(7 % d); putch(10);
+  return a / b + 2147483647 + 1;
+}
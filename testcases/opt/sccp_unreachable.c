@@ -0,0 +1,31 @@
+// branches on constants leave the blocks they never take unreachable, with
+// the values passed along the edges taken
+const int DEBUG = 0;
+
+int f(int n) {
+  int s = 0, i = 0, k = 3;
+  while (i < n) {
+    if (DEBUG) {
+      putint(i);
+      putch(10);
+    }
+    int t = k * 2;
+    if (t == 6) s = s + i;
+    else s = s - 1;
+    i = i + 1;
+  }
+  return s;
+}
+
+int main() {
+  int a = 5, b;
+  if (a > 3) b = 1;
+  else b = 2;
+  int c = b + 10;
+  while (c < 0) {
+    c = c + 1;
+  }
+  putint(c); putch(10);
+  putint(f(10)); putch(10);
+  return c;
+}
@@ -0,0 +1,32 @@
+// compiled with `-march=rv32imc` and assembled by clang in `make test-rvc`,
+// so that a compressed form the assembler does not accept fails the test
+
+int a[32];
+
+int mix(int x, int y) {
+    int s = x + y;
+    s = s - x * 4;
+    s = s + y / 8 + x % 16 + y / 3;
+    if (x != y) s = s + 1;
+    if (x == y) s = s - 1;
+    return s;
+}
+
+int main() {
+    int i = 0;
+    while (i < 32) {
+        a[i] = i * i - 7;
+        i = i + 1;
+    }
+
+    int sum = 0, j = 0;
+    while (j < 32) {
+        sum = sum + mix(a[j], j * 8 + 3);
+        if (a[j] > 100 && a[j] < 500 || j == 5) sum = sum - a[j] / 4;
+        j = j + 1;
+    }
+
+    putint(sum);
+    putch(10);
+    return 0;
+}